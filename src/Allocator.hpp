@@ -5,30 +5,63 @@
 #include <exception>
 #include <cstddef>
 #include <new>
+#if __cplusplus >= 201103L
+#    include <type_traits>
+#endif
 #include <complex>
 #include <xmmintrin.h>
 
+#include "Arena.hpp"
+#if defined(__linux__)
+#    include <sys/mman.h>
+#endif
+
+/// Construction and backing modes of AlignmentAllocator (may be or'ed)
+enum AllocMode {
+    ALLOC_DEFAULT  = 0, /**< Value-initialise, plain aligned heap */
+    ALLOC_NOINIT   = 1, /**< Default-initialise, i.e. leave PODs uninitialised on resize */
+    ALLOC_HUGEPAGE = 2, /**< Back large blocks by 2MB transparent huge pages */
+    ALLOC_ARENA    = 4  /**< Draw from this thread's Arena if an ArenaScope is open */
+};
+
+inline AllocMode operator| (const AllocMode a, const AllocMode b) {
+    return static_cast<AllocMode>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+}
+
+const static std::size_t HUGEPAGE_SIZE = 2097152;
+
 template<std::size_t alignment>
 struct static_allocator {
     
-    static void* allocate(std::size_t n) {
+    static void* allocate(std::size_t n, bool huge = false) {
 
         if(n == 0)
             return 0;
         
         if(n > max_size())
             throw std::bad_alloc();
+
+        // Huge pages only pay off for blocks of at least one page
+        huge = huge && n >= HUGEPAGE_SIZE;
+        if (huge)
+            n = ((n + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE) * HUGEPAGE_SIZE;
+
         void* ret =
 #if defined(__GNUC__) || defined (__INTEL_COMPILER)
             _mm_malloc
 #else
             _aligned_malloc
 #endif
-            (n,alignment);
+            (n, huge ? HUGEPAGE_SIZE : alignment);
         
         if(!ret)
             throw std::bad_alloc();
 
+#if defined(MADV_HUGEPAGE)
+        if (huge)
+            madvise (ret, n, MADV_HUGEPAGE);
+#endif
+
         return ret;
 
     }
@@ -58,7 +91,7 @@ struct static_allocator<1> {
         return std::numeric_limits<std::size_t>::max();
     }
     
-    static void* allocate (std::size_t n) { 
+    static void* allocate (std::size_t n, const bool = false) {
 
         if(n == 0)
             return 0;
@@ -97,12 +130,59 @@ public:
         typedef AlignmentAllocator<_Tp1, alignment> other;
     };
     
-    AlignmentAllocator() {}
+#if __cplusplus >= 201103L
+    // Move assignment keeps the target's storage kind: arena storage is not
+    // moved out into a container of the enclosing scope. Swap is explicit.
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+#endif
+
+    // Arena mode: the innermost open scope of this thread's arena, if any
+    AlignmentAllocator(const AllocMode mode = ALLOC_DEFAULT) :
+        _mode(mode), _arena(0), _depth(0), _scope(0) {
+        if ((_mode & ALLOC_ARENA) && Arena::Local().Active()) {
+            _arena = &Arena::Local();
+            _depth = _arena->Depth();
+            _scope = _arena->Scope();
+        }
+    }
     
-    AlignmentAllocator(const AlignmentAllocator&) {}
+    AlignmentAllocator(const AlignmentAllocator& a) :
+        _mode(a.Mode()), _arena(a.GetArena()), _depth(a.ScopeDepth()), _scope(a.Scope()) {}
     
     template <typename _Tp1>
-    AlignmentAllocator(const AlignmentAllocator<_Tp1, alignment> &) {}
+    AlignmentAllocator(const AlignmentAllocator<_Tp1, alignment> & a) :
+        _mode(a.Mode()), _arena(a.GetArena()), _depth(a.ScopeDepth()), _scope(a.Scope()) {}
+
+    inline AllocMode Mode () const {
+        return _mode;
+    }
+
+    inline Arena* GetArena () const {
+        return _arena;
+    }
+
+    inline std::size_t ScopeDepth () const {
+        return _depth;
+    }
+
+    inline std::size_t Scope () const {
+        return _scope;
+    }
+
+    // Arena usable: this thread's and the scope open and innermost (an
+    // inner scope would rewind over growth). Scope ids are not reused.
+    inline bool InScope () const {
+        return _arena && _arena == &Arena::Local() && _depth == _arena->Depth() &&
+            _arena->Open(_depth, _scope);
+    }
+
+#if __cplusplus >= 201103L
+    // Copies of arena backed containers must survive the arena scope
+    AlignmentAllocator select_on_container_copy_construction () const {
+        return AlignmentAllocator(static_cast<AllocMode>(_mode & ~ALLOC_ARENA));
+    }
+#endif
     
     ~AlignmentAllocator() {}
     
@@ -126,12 +206,27 @@ public:
 
     }
     
+    // Heap once the arena is out of scope or another thread's
     pointer allocate (size_type n, const void* = 0) {
-        return static_cast<pointer>(static_alloc::allocate(n*sizeof(value_type)));
+        if (InScope())
+            return static_cast<pointer>(_arena->Allocate(n*sizeof(value_type),
+                    (alignment > 1) ? alignment : 1));
+        return static_cast<pointer>(static_alloc::allocate(n*sizeof(value_type),
+                _mode & ALLOC_HUGEPAGE));
     }
     
-    void deallocate (pointer p, size_type) {
-        static_alloc::deallocate(p);
+    // Arena storage is left to the arena (popped if last and in scope).
+    // Another thread cannot inspect the arena safely and leaks the heap
+    // blocks it drops.
+    void deallocate (pointer p, size_type n) {
+        if (!_arena)
+            static_alloc::deallocate(p);
+        else if (_arena != &Arena::Local())
+            return;
+        else if (!_arena->Owns(p))
+            static_alloc::deallocate(p);
+        else if (InScope())
+            _arena->Deallocate(p, n*sizeof(value_type));
     }
     
     size_type max_size () const {
@@ -144,6 +239,15 @@ public:
     void construct(_Up* p, _Args&&... args) {
         ::new(static_cast<void*>(p)) _Up(std::forward<_Args>(args)...);
     }
+
+    // Used by resize(n): default- rather than value-initialise in no-init mode
+    template<typename _Up>
+    void construct(_Up* p) {
+        if (_mode & ALLOC_NOINIT)
+            ::new(static_cast<void*>(p)) _Up;
+        else
+            ::new(static_cast<void*>(p)) _Up();
+    }
     
     template<typename _Up>
     void destroy(_Up* p) {
@@ -162,17 +266,24 @@ public:
 
 #endif
     
-    bool operator!=(const AlignmentAllocator&) const {
-        return false;
+    bool operator!=(const AlignmentAllocator& a) const {
+        return !(*this == a);
     }
     
     // Returns true if and only if storage allocated from *this
     // can be deallocated from other, and vice versa.
-    // Always returns true for stateless allocators.
-    bool operator==(const AlignmentAllocator&) const  {
-        return true;
+    // Only arena backing (and its scope) affects deallocation.
+    bool operator==(const AlignmentAllocator& a) const  {
+        return _arena == a.GetArena() && _scope == a.Scope();
     }
 
+private:
+
+    AllocMode   _mode;
+    Arena*      _arena;
+    std::size_t _depth;  // Of the scope
+    std::size_t _scope;  // Id
+
 };// class AlignmentAllocator<>
 
 /// AlignmentAllocator<void> specialization.
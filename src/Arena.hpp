@@ -0,0 +1,244 @@
+/*
+ * Arena.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef ARENA_HPP_
+#define ARENA_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Per-thread bump allocator for short-lived temporaries.
+ *
+ *        Allocation is a pointer bump within the current block, single
+ *        deallocations are no-ops (except for the most recent allocation
+ *        which is popped). All memory handed out after a mark is released at once
+ *        by rewinding to that mark (see ArenaScope). Blocks are kept for
+ *        reuse by the next run. Not thread-safe: use Arena::Local().
+ */
+class Arena {
+
+	struct Block {
+		char*  ptr;
+		size_t size;
+		size_t used;
+	};
+
+public:
+
+	/**
+	 * @brief Position to rewind to
+	 */
+	struct Mark {
+		size_t block;
+		size_t used;
+	};
+
+	/**
+	 * @brief Construct empty arena
+	 *
+	 * @param block  Minimum block size in bytes
+	 */
+	explicit Arena (const size_t block = 1048576) :
+		_block(block), _current(0), _scopes(0) {}
+
+	~Arena () {
+		for (size_t i = 0; i < _blocks.size(); ++i)
+			free (_blocks[i].ptr);
+	}
+
+	/**
+	 * @brief Allocate n bytes aligned to alignment (power of 2)
+	 *
+	 * @param n          Bytes
+	 * @param alignment  Alignment
+	 * @return           Memory
+	 */
+	void* Allocate (const size_t n, const size_t alignment) {
+		if (n == 0)
+			return 0;
+		for (; _current < _blocks.size(); ++_current) {
+			Block& b = _blocks[_current];
+			size_t pos = (((size_t)b.ptr + b.used + alignment - 1) & ~(alignment - 1))
+					- (size_t)b.ptr;
+			if (pos + n <= b.size) {
+				b.used = pos + n;
+				return b.ptr + pos;
+			}
+		}
+		Block b;
+		b.size = std::max (_block, n + alignment);
+		b.ptr  = static_cast<char*>(malloc(b.size));
+		if (!b.ptr)
+			throw std::bad_alloc();
+		b.used = 0;
+		_blocks.push_back(b);
+		_current = _blocks.size() - 1;
+		return Allocate (n, alignment);
+	}
+
+	/**
+	 * @brief Release p if it was the last allocation, otherwise no-op
+	 *
+	 * @param p  Memory
+	 * @param n  Bytes
+	 */
+	inline void Deallocate (void* p, const size_t n) {
+		if (_current < _blocks.size()) {
+			Block& b = _blocks[_current];
+			if (static_cast<char*>(p) + n == b.ptr + b.used)
+				b.used = static_cast<char*>(p) - b.ptr;
+		}
+	}
+
+	/**
+	 * @brief Current position
+	 */
+	inline Mark Position () const {
+		Mark m;
+		m.block = _current;
+		m.used  = (_current < _blocks.size()) ? _blocks[_current].used : 0;
+		return m;
+	}
+
+	/**
+	 * @brief Release everything allocated since m
+	 *
+	 * @param m  Mark
+	 */
+	inline void Rewind (const Mark& m) {
+		for (size_t i = m.block + 1; i < _blocks.size(); ++i)
+			_blocks[i].used = 0;
+		if (m.block < _blocks.size())
+			_blocks[m.block].used = m.used;
+		_current = m.block;
+	}
+
+	/**
+	 * @brief Release everything
+	 */
+	inline void Reset () {
+		Mark m = {0, 0};
+		Rewind (m);
+	}
+
+	/**
+	 * @brief Bytes in use
+	 */
+	inline size_t Used () const {
+		size_t u = 0;
+		for (size_t i = 0; i < _blocks.size(); ++i)
+			u += _blocks[i].used;
+		return u;
+	}
+
+	/**
+	 * @brief Bytes reserved
+	 */
+	inline size_t Capacity () const {
+		size_t c = 0;
+		for (size_t i = 0; i < _blocks.size(); ++i)
+			c += _blocks[i].size;
+		return c;
+	}
+
+	/**
+	 * @brief Memory p lies in one of the blocks
+	 */
+	bool Owns (const void* p) const {
+		const char* c = static_cast<const char*>(p);
+		for (size_t i = 0; i < _blocks.size(); ++i)
+			if (c >= _blocks[i].ptr && c < _blocks[i].ptr + _blocks[i].size)
+				return true;
+		return false;
+	}
+
+	/**
+	 * @brief Number of open scopes. Allocators only draw from an active arena.
+	 */
+	inline size_t Depth () const { return _open.size(); }
+	inline bool Active () const { return !_open.empty(); }
+
+	/**
+	 * @brief Id of the innermost open scope, unique over the arena's life
+	 *        (0: none)
+	 */
+	inline size_t Scope () const { return _open.empty() ? 0 : _open.back(); }
+
+	/**
+	 * @brief Scope id opened at depth (1 outermost) still open
+	 */
+	inline bool Open (const size_t depth, const size_t id) const {
+		return depth > 0 && depth <= _open.size() && _open[depth-1] == id;
+	}
+
+	inline void Enter () { _open.push_back (++_scopes); }
+	inline void Leave () { _open.pop_back(); }
+
+	/**
+	 * @brief This thread's arena
+	 */
+	static Arena& Local () {
+#if __cplusplus >= 201103L
+		static thread_local Arena arena;
+#else
+		static Arena arena; // No thread-local storage before C++11
+#endif
+		return arena;
+	}
+
+private:
+
+	Arena (const Arena&);
+	Arena& operator= (const Arena&);
+
+	std::vector<Block> _blocks;
+	size_t _block;
+	size_t _current;
+	size_t _scopes;             // Opened so far
+	std::vector<size_t> _open;  // Ids of open scopes, innermost last
+
+};
+
+
+/**
+ * @brief Scope of a run or chunk: Temporaries allocated with ALLOC_ARENA on
+ *        this thread between construction and destruction are released in
+ *        one go on destruction. Containers allocated within must not outlive
+ *        the scope. Copies of such containers are allocated on the heap, and
+ *        so is growth after the scope closed or on another thread (see
+ *        AlignmentAllocator).
+ */
+class ArenaScope {
+
+public:
+
+	ArenaScope () : _arena(Arena::Local()), _mark(_arena.Position()) {
+		_arena.Enter();
+	}
+
+	~ArenaScope () {
+		_arena.Leave();
+		_arena.Rewind(_mark);
+	}
+
+	inline Arena& GetArena () { return _arena; }
+
+private:
+
+	ArenaScope (const ArenaScope&);
+	ArenaScope& operator= (const ArenaScope&);
+
+	Arena&      _arena;
+	Arena::Mark _mark;
+
+};
+
+#endif /* ARENA_HPP_ */
@@ -0,0 +1,179 @@
+/*
+ * Benchmark.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef BENCHMARK_HPP_
+#define BENCHMARK_HPP_
+
+#include "Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <time.h>
+
+/**
+ * @brief Heap allocation counter. Only counts in the benchmark executable,
+ *        where malloc & co are wrapped (glibc only, see below). Include in
+ *        one translation unit only.
+ */
+static volatile size_t _n_allocs = 0;
+
+inline static size_t
+AllocationCount () {
+	return _n_allocs;
+}
+
+#if defined (__GLIBC__)
+extern "C" {
+	void* __libc_malloc  (size_t);
+	void* __libc_calloc  (size_t, size_t);
+	void* __libc_realloc (void*, size_t);
+	void* __libc_memalign (size_t, size_t);
+	void  __libc_free    (void*);
+	void* malloc (size_t n) __THROW {
+		__sync_fetch_and_add (&_n_allocs, 1);
+		return __libc_malloc (n);
+	}
+	void* calloc (size_t n, size_t s) __THROW {
+		__sync_fetch_and_add (&_n_allocs, 1);
+		return __libc_calloc (n, s);
+	}
+	void* realloc (void* p, size_t n) __THROW {
+		__sync_fetch_and_add (&_n_allocs, 1);
+		return __libc_realloc (p, n);
+	}
+	int posix_memalign (void** p, size_t a, size_t n) __THROW {
+		__sync_fetch_and_add (&_n_allocs, 1);
+		*p = __libc_memalign (a, n);
+		return (*p) ? 0 : 12; // ENOMEM
+	}
+	void* aligned_alloc (size_t a, size_t n) __THROW {
+		__sync_fetch_and_add (&_n_allocs, 1);
+		return __libc_memalign (a, n);
+	}
+	void free (void* p) __THROW {
+		__libc_free (p);
+	}
+}
+#endif
+
+
+/**
+ * @brief Keep the optimiser from discarding computation of v
+ */
+template<class T> inline static void
+escape (T& v) {
+#if defined (__GNUC__)
+	__asm__ __volatile__ ("" : : "g"(&v) : "memory");
+#else
+	volatile char c = *reinterpret_cast<volatile char*>(&v);
+	(void) c;
+#endif
+}
+
+/**
+ * @brief Result of one benchmark
+ */
+struct BenchResult {
+	std::string name;
+	size_t      calls;   /**< @brief Calls of the benchmark functor */
+	double      ops;     /**< @brief Operations (e.g. RHS evaluations, spins) */
+	double      ns;      /**< @brief Total wall time */
+	double      allocs;  /**< @brief Heap allocations */
+	double      bytes;   /**< @brief Bytes moved (I/O benchmarks), 0 otherwise */
+	double      steps;   /**< @brief Integration steps (set by caller), 0 otherwise */
+};
+
+
+/**
+ * @brief Minimal benchmark harness: Runs functors repeatedly for a minimum
+ *        time and reports ns/op, ops/s and allocations/op as JSON.
+ */
+class Benchmark {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param suite     Suite name
+	 * @param min_time  Minimum measurement time per benchmark in seconds
+	 */
+	Benchmark (const std::string& suite, const double min_time = .5) :
+		_suite(suite), _min_ns(1.e9*min_time) {}
+
+	/**
+	 * @brief Run f() until min_time has passed (at least once)
+	 *
+	 * @param name   Benchmark name
+	 * @param f      Functor. Returns number of operations per call.
+	 * @param bytes  Bytes moved per call (for bandwidth)
+	 * @return       Result, open for the caller to add steps
+	 */
+	template<class F> BenchResult&
+	Run (const std::string& name, F& f, const double bytes = 0.) {
+		BenchResult r;
+		r.name  = name;
+		r.calls = 0;
+		r.ops   = 0.;
+		r.bytes = 0.;
+		r.steps = 0.;
+		std::cerr << "  " << std::setw(32) << std::left << name << std::flush;
+		size_t a0 = AllocationCount();
+		Timer timer;
+		do {
+			timer.Start();
+			r.ops += f();
+			timer.Stop();
+			r.bytes += bytes;
+			++r.calls;
+		} while (timer.Elapsed() < _min_ns);
+		r.ns     = timer.Elapsed();
+		r.allocs = AllocationCount() - a0;
+		std::cerr << std::right << std::setw(14) << std::setprecision(4)
+				<< r.ns/r.ops << " ns/op" << std::endl;
+		_results.push_back(r);
+		return _results.back();
+	}
+
+	/**
+	 * @brief Report as JSON
+	 *
+	 * @param os  Output stream
+	 * @param version  Software version
+	 */
+	std::ostream& Report (std::ostream& os, const std::string& version) const {
+		os << "{\n  \"suite\": \"" << _suite << "\",\n  \"version\": \"" << version
+		   << "\",\n  \"timestamp\": " << time(0) << ",\n  \"benchmarks\": [\n";
+		for (size_t i = 0; i < _results.size(); ++i) {
+			const BenchResult& r = _results[i];
+			os << "    {\"name\": \"" << r.name << "\", \"calls\": " << r.calls
+			   << std::setprecision(6) << std::scientific
+			   << ", \"ops\": " << r.ops
+			   << ", \"ns_per_op\": " << r.ns/r.ops
+			   << ", \"ops_per_sec\": " << 1.e9*r.ops/r.ns
+			   << ", \"allocs_per_op\": " << r.allocs/r.ops;
+			if (r.bytes > 0.)
+				os << ", \"bytes_per_sec\": " << 1.e9*r.bytes/r.ns;
+			if (r.steps > 0.)
+				os << ", \"steps_per_op\": " << r.steps/r.ops;
+			os << std::fixed << "}" << ((i+1 < _results.size()) ? "," : "") << "\n";
+		}
+		return os << "  ]\n}\n";
+	}
+
+private:
+
+	std::string _suite;
+	double _min_ns;
+	std::vector<BenchResult> _results;
+
+};
+
+#endif /* BENCHMARK_HPP_ */
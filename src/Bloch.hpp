@@ -12,11 +12,13 @@
 #include "NDData.hpp"
 #include "AdiabaticRF.hpp"
 #include "HardRF.hpp"
+#include "RepeatRF.hpp"
+#include "SampledRF.hpp"
+#include "Spoiler.hpp"
+#include "Stats.hpp"
 
 #include <boost/array.hpp>
 
-const double GAMMA = 4.2577480e7;
-
 
 template<class T> class Bloch {
 
@@ -29,17 +31,63 @@ public:
 		return true;
 	}
 
+	/**
+	 * @brief Add spoiler, kept in time order
+	 */
+	inline bool AddEvent (const Spoiler<T>& spoiler) {
+		typename std::vector<const Spoiler<T>*>::iterator it = _spoilers.begin();
+		while (it != _spoilers.end() && (*it)->Time() <= spoiler.Time())
+			++it;
+		_spoilers.insert(it, &spoiler);
+		return true;
+	}
+
+	inline void ClearEvents () {
+		_rfs.clear();
+		_spoilers.clear();
+	}
+
+	inline const std::vector<const RF<T>*>& GetEvents () const {
+		return _rfs;
+	}
+
+	inline const std::vector<const Spoiler<T>*>& GetSpoilers () const {
+		return _spoilers;
+	}
+
 	inline std::complex<T> GetRF (const double t) const {
 		std::complex<T> rft (0.,0.);
-		for (size_t i = 0; i < _rfs.size(); ++i)
+		for (size_t i = 0; i < _rfs.size(); ++i) {
+			STATS_TIMER(timer);
 			rft += (*_rfs[i])(t);
+			STATS_EVENT(i, timer);
+		}
+		STATS_ADD(RF_CALLS, _rfs.size());
 		return rft;
 	}
 
+	/**
+	 * @brief Time derivative of the RF sum
+	 */
+	inline std::complex<T> GetRFDerivative (const double t) const {
+		std::complex<T> drft (0.,0.);
+		for (size_t i = 0; i < _rfs.size(); ++i)
+			drft += _rfs[i]->Derivative(t);
+		return drft;
+	}
+
+	/**
+	 * @brief Simulation environment of the calling thread
+	 */
 	static Bloch& Instance() {
+#if __cplusplus >= 201103L
+		static thread_local Bloch<T> instance;
+		return instance;
+#else
 		if (!_instance)
 			_instance = new Bloch<T>();
 		return *_instance;
+#endif
 	}
 
 	inline void SetSpin (const Spin<T>& spin) {
@@ -53,6 +101,7 @@ protected:
 
 	Spin<T> _spin;
 	std::vector<const RF<T>*> _rfs;
+	std::vector<const Spoiler<T>*> _spoilers;
 	static Bloch<T>* _instance;
 
 	Bloch(){};
@@ -64,8 +113,8 @@ template<> Bloch<float>* Bloch<float>::_instance = 0;
 
 typedef boost::array<double, 3> state_type;
 
-template<class T> void multiply (const state_type &m,
-		codeare::container<T>B, state_type& dm) {
+template<class T> inline void multiply (const state_type &m,
+		const boost::array<T,9>& B, state_type& dm) {
 
 	dm[0] = B[0]*m[0] + B[3]*m[1] + B[6]*m[2];
 	dm[1] = B[1]*m[0] + B[4]*m[1] + B[7]*m[2];
@@ -73,8 +122,15 @@ template<class T> void multiply (const state_type &m,
 
 }
 
-template<class T> void bloch (const state_type &m,
-		state_type& dm, double t) {
+/**
+ * @brief Assemble Bloch matrix B (column major) of the calling thread's
+ *        environment at time t, such that dm/dt = B m + (0, 0, pd/T1).
+ *
+ * @param t  Time
+ * @param B  Bloch matrix
+ * @return   pd/T1
+ */
+template<class T> inline T bloch_matrix (const double t, boost::array<T,9>& B) {
 
 	const Spin<T>& spin = Bloch<T>::Instance().GetSpin();
 	const std::complex<T> rf = Bloch<T>::Instance().GetRF(t);
@@ -82,17 +138,133 @@ template<class T> void bloch (const state_type &m,
 	double bx = GAMMA*real(rf), by = GAMMA*imag(rf),
 			bz = 0. + spin.cs(), r1=1./spin.t1(), r2=1./spin.t2();
 
-	codeare::container<T> B (9,0.);
 	B[0] = -r2; B[3] =  bz; B[6] = -by;
 	B[1] = -bz; B[4] = -r2; B[7] =  bx;
 	B[2] =  by; B[5] = -bx; B[8] = -r1;
 
+	return spin.pd()*r1;
+
+}
+
+/**
+ * @brief Bloch equations dm/dt = B m + (0, 0, pd/T1) (odeint system)
+ */
+template<class T> void bloch (const state_type &m,
+		state_type& dm, double t) {
+
+	STATS_INC(RHS_CALLS);
+	boost::array<T,9> B; // on stack, no allocation per RHS call
+	const T pdr1 = bloch_matrix<T> (t, B);
+
+	multiply (m, B, dm);
+	dm[2] += pdr1;
+
+}
+
+/**
+ * @brief Jacobian of the Bloch equations: J = B (the system is linear in m)
+ *        and the explicit time derivative df/dt = dB/dt m, where only the
+ *        RF terms depend on t.
+ *
+ * @param m     Magnetisation
+ * @param J     Jacobian (3x3, column major as B)
+ * @param t     Time
+ * @param dfdt  Explicit time derivative
+ */
+template<class T> void bloch_jacobian (const state_type& m,
+		boost::array<T,9>& J, const double t, state_type& dfdt) {
+
+	STATS_INC(JACOBIAN_CALLS);
+	bloch_matrix<T> (t, J);
+
+	const std::complex<T> drf = Bloch<T>::Instance().GetRFDerivative(t);
+	const double dbx = GAMMA*real(drf), dby = GAMMA*imag(drf);
+
+	dfdt[0] = -dby*m[2];
+	dfdt[1] =  dbx*m[2];
+	dfdt[2] =  dby*m[0] - dbx*m[1];
+
+}
+
+
+/**
+ * @brief Rotate m about z by phi: mx + i my -> (mx + i my) exp(i phi).
+ *        Maps the RF frame to the frame rotating at off-resonance cs
+ *        (phi = cs t) and back (phi = -cs t).
+ */
+inline void rotate_z (state_type& m, const double phi) {
+	const double c = std::cos(phi), s = std::sin(phi), x = m[0];
+	m[0] = c*x - s*m[1];
+	m[1] = s*x + c*m[1];
+}
+
+/**
+ * @brief Bloch matrix in the frame rotating at the spin's off-resonance
+ *        (interaction picture): no precession term, RF phase modulated by
+ *        exp(i cs t). Relaxation commutes with the frame rotation.
+ *
+ * @param t  Time
+ * @param B  Bloch matrix
+ * @param rf RF in that frame
+ * @return   pd/T1
+ */
+template<class T> inline T bloch_matrix_spin_frame (const double t, boost::array<T,9>& B,
+		std::complex<T>& rf) {
+
+	const Spin<T>& spin = Bloch<T>::Instance().GetSpin();
+	rf = Bloch<T>::Instance().GetRF(t);
+	if (rf != std::complex<T>(0.,0.))
+		rf *= std::polar ((T)1., (T)(spin.cs()*t));
+
+	double bx = GAMMA*real(rf), by = GAMMA*imag(rf), r1=1./spin.t1(), r2=1./spin.t2();
+
+	B[0] = -r2; B[3] =  0.; B[6] = -by;
+	B[1] =  0.; B[4] = -r2; B[7] =  bx;
+	B[2] =  by; B[5] = -bx; B[8] = -r1;
+
+	return spin.pd()*r1;
+
+}
+
+/**
+ * @brief Bloch equations in the frame rotating at the spin's off-resonance
+ *        (odeint system). Without RF the solution is pure relaxation, which
+ *        adaptive steppers cross in few steps whatever cs.
+ */
+template<class T> void bloch_spin_frame (const state_type &m,
+		state_type& dm, double t) {
+
+	STATS_INC(RHS_CALLS);
+	boost::array<T,9> B;
+	std::complex<T> rf;
+	const T pdr1 = bloch_matrix_spin_frame<T> (t, B, rf);
+
 	multiply (m, B, dm);
-	dm[2] += spin.pd()*r1;
+	dm[2] += pdr1;
 
 }
 
+/**
+ * @brief Jacobian of bloch_spin_frame(): d/dt (rf exp(i cs t)) =
+ *        (drf/dt + i cs rf) exp(i cs t)
+ */
+template<class T> void bloch_jacobian_spin_frame (const state_type& m,
+		boost::array<T,9>& J, const double t, state_type& dfdt) {
+
+	STATS_INC(JACOBIAN_CALLS);
+	std::complex<T> rf;
+	bloch_matrix_spin_frame<T> (t, J, rf);
 
+	const T cs = Bloch<T>::Instance().GetSpin().cs();
+	const std::complex<T> drf = Bloch<T>::Instance().GetRFDerivative(t) *
+			std::polar ((T)1., (T)(cs*t)) + std::complex<T>(0., cs) * rf;
+	const double dbx = GAMMA*real(drf), dby = GAMMA*imag(drf);
+
+	dfdt[0] = -dby*m[2];
+	dfdt[1] =  dbx*m[2];
+	dfdt[2] =  dby*m[0] - dbx*m[1];
+
+}
 
 
 #endif /* BLOCH_HPP_ */
@@ -0,0 +1,189 @@
+/*
+ * BlochMcConnell.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef BLOCHMCCONNELL_HPP_
+#define BLOCHMCCONNELL_HPP_
+
+#include "Bloch.hpp"
+#include "Stepper.hpp"
+
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief Magnetisation pool: relative density, relaxation and chemical shift
+ */
+template<class T> struct Pool {
+
+	Pool (const T pd_ = 1., const T t1_ = 1., const T t2_ = .1, const T cs_ = 0.) :
+		pd(pd_), t1(t1_), t2(t2_), cs(cs_) {}
+
+	T pd; /**< @brief Equilibrium magnetisation M0 */
+	T t1; /**< @brief T1 [s] */
+	T t2; /**< @brief T2 [s] */
+	T cs; /**< @brief Chemical shift [rad/s] */
+
+};
+
+/**
+ * @brief State of P pools x S spins: pool blocks of 3 component planes of S
+ *        spins each, m[(3p+c)S + s]
+ */
+typedef std::vector<double> mc_state_type;
+
+
+/**
+ * @brief Bloch-McConnell equations: P exchanging pools, batched over S spins
+ *        differing in off-resonance. The 3P x 3P system matrix is block
+ *        diagonal Bloch blocks plus exchange K (x) I3; it is never formed.
+ *        Bloch blocks are applied per pool, exchange per coupled pool pair,
+ *        each as a loop over spins. RF from the Bloch<T> environment of the
+ *        calling thread acts on all pools. All spins share the step size.
+ */
+template<class T> class BlochMcConnell {
+
+	/** Directed transfer from -> to with rate k [1/s] */
+	struct Transfer {
+		size_t from, to;
+		T k;
+	};
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param pools    Pools
+	 * @param offsets  Per spin off-resonance [rad/s] (added to all pools)
+	 */
+	BlochMcConnell (const std::vector<Pool<T> >& pools, const std::vector<T>& offsets) :
+		_pools(pools), _offsets(offsets) {}
+
+	/**
+	 * @brief Exchange between pools a and b, rate k_ab from a to b. Back
+	 *        rate from detailed balance: k_ba = k_ab M0_a / M0_b.
+	 */
+	void Exchange (const size_t a, const size_t b, const T k_ab) {
+		assert (a < _pools.size() && b < _pools.size() && a != b);
+		Transfer ab = { a, b, k_ab }, ba = { b, a, k_ab * _pools[a].pd / _pools[b].pd };
+		_transfers.push_back (ab);
+		_transfers.push_back (ba);
+	}
+
+	inline size_t Pools () const { return _pools.size(); }
+	inline size_t Spins () const { return _offsets.size(); }
+	inline size_t Size () const { return 3 * Pools() * Spins(); }
+
+	/**
+	 * @brief State index of component c of pool p of spin s
+	 */
+	inline size_t Index (const size_t c, const size_t p, const size_t s) const {
+		return (3*p + c) * Spins() + s;
+	}
+
+	/**
+	 * @brief Thermal equilibrium (mz = M0 in all pools)
+	 */
+	mc_state_type Equilibrium () const {
+		mc_state_type m (Size(), 0.);
+		for (size_t p = 0; p < Pools(); ++p)
+			for (size_t s = 0; s < Spins(); ++s)
+				m[Index(2,p,s)] = _pools[p].pd;
+		return m;
+	}
+
+	/**
+	 * @brief RHS
+	 */
+	void operator() (const mc_state_type& m, mc_state_type& dm, const double t) const {
+
+		STATS_INC(RHS_CALLS);
+		const size_t S = Spins();
+		const std::complex<T> rf = Bloch<T>::Instance().GetRF(t);
+		const double bx = GAMMA*real(rf), by = GAMMA*imag(rf);
+		const T* off = &_offsets[0];
+
+		for (size_t p = 0; p < Pools(); ++p) { // Bloch blocks
+			const double r1 = 1./_pools[p].t1, r2 = 1./_pools[p].t2,
+					pdr1 = _pools[p].pd*r1, cs = _pools[p].cs;
+			const double *x = &m[3*p*S], *y = x + S, *z = y + S;
+			double *dx = &dm[3*p*S], *dy = dx + S, *dz = dy + S;
+#pragma omp parallel for simd schedule(static) if (S > PAR_THRESHOLD)
+			for (size_t s = 0; s < S; ++s) {
+				const double bz = cs + off[s];
+				dx[s] = -r2*x[s] + bz*y[s] - by*z[s];
+				dy[s] = -bz*x[s] - r2*y[s] + bx*z[s];
+				dz[s] =  by*x[s] - bx*y[s] - r1*z[s] + pdr1;
+			}
+		}
+
+		for (size_t i = 0; i < _transfers.size(); ++i) { // Exchange
+			const double k = _transfers[i].k;
+			const double* a = &m[3*_transfers[i].from*S];
+			double* da = &dm[3*_transfers[i].from*S], *db = &dm[3*_transfers[i].to*S];
+#pragma omp parallel for simd schedule(static) if (S > PAR_THRESHOLD)
+			for (size_t j = 0; j < 3*S; ++j) {
+				da[j] -= k*a[j];
+				db[j] += k*a[j];
+			}
+		}
+
+	}
+
+	/**
+	 * @brief Explicit steppers only: rosenbrock4 would need the Jacobian of
+	 *        all spins, splitting and magnus4 act on a single spin
+	 *
+	 * @param config  Stepper configuration
+	 * @return        Supported (otherwise reported to std::cerr)
+	 */
+	static bool Supports (const StepperConfig& config) {
+		if (config.Valid() && config.type != ROSENBROCK4 && config.type != SPLITTING &&
+				config.type != MAGNUS4)
+			return true;
+		std::cerr << "Bloch-McConnell: unsupported stepper " << config << std::endl;
+		return false;
+	}
+
+	/**
+	 * @brief Integrate from t0 to t1 (explicit steppers, see Supports())
+	 *
+	 * @param m       State (in: initial, out: final)
+	 * @param t0      Start time
+	 * @param t1      End time
+	 * @param config  Stepper configuration
+	 * @return        Number of steps (0 and m unchanged if unsupported)
+	 */
+	size_t Integrate (mc_state_type& m, const double t0, const double t1,
+			const StepperConfig& config = StepperConfig()) const {
+		if (!Supports (config))
+			return 0;
+		return IntegrateExplicit (config, boost::cref(*this), m, t0, t1,
+				boost::numeric::odeint::null_observer());
+	}
+
+	/**
+	 * @brief State as 3 x pools x spins
+	 */
+	NDData<double> Magnetisation (const mc_state_type& m) const {
+		NDData<double> ret (3, Pools(), Spins());
+		for (size_t s = 0; s < Spins(); ++s)
+			for (size_t p = 0; p < Pools(); ++p)
+				for (size_t c = 0; c < 3; ++c)
+					ret(c,p,s) = m[Index(c,p,s)];
+		return ret;
+	}
+
+private:
+
+	std::vector<Pool<T> > _pools;
+	std::vector<T> _offsets;
+	std::vector<Transfer> _transfers;
+
+};
+
+#endif /* BLOCHMCCONNELL_HPP_ */
@@ -0,0 +1,320 @@
+/*
+ * Checkpoint.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef CHECKPOINT_HPP_
+#define CHECKPOINT_HPP_
+
+#include "Bloch.hpp"
+#include "HDF5File.hpp"
+#include "Timer.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/**
+ * @brief State of a run at a checkpoint, all a restart resumes from
+ */
+struct Snapshot {
+
+	Snapshot () : t0(0.), t1(0.), t(0.), dt(0.), spins(0), slices(0), hash(0) {
+		m0[0] = 0.; m0[1] = 0.; m0[2] = 1.;
+	}
+
+	/**
+	 * @brief Run description (no progress yet)
+	 *
+	 * @param t0      Start time
+	 * @param t1      End time
+	 * @param dt      Stepper dt every segment starts with
+	 * @param m0      Initial magnetisation
+	 * @param spins   Spins in the sample
+	 * @param slices  Trajectories: slices of the time span (0: sample run)
+	 * @param hash    Run hash: spins, stepper and events (see RunHash())
+	 */
+	Snapshot (const double t0, const double t1, const double dt, const state_type& m0,
+			const size_t spins, const size_t slices = 0, const uint64_t hash = 0) :
+		t0(t0), t1(t1), t(t0), dt(dt), m0(m0), spins(spins), slices(slices), hash(hash) {}
+
+	/**
+	 * @brief Same run: time span, stepper dt, m0, spins, slices and run hash
+	 */
+	inline bool Matches (const Snapshot& s) const {
+		return t0 == s.t0 && t1 == s.t1 && dt == s.dt && spins == s.spins &&
+				slices == s.slices && m0[0] == s.m0[0] && m0[1] == s.m0[1] && m0[2] == s.m0[2] &&
+				hash == s.hash;
+	}
+
+	double t0, t1;                 /**< @brief Time span */
+	double t;                      /**< @brief Integrated up to (trajectories) */
+	double dt;                     /**< @brief Stepper dt every segment starts with */
+	state_type m0;                 /**< @brief Initial magnetisation */
+	size_t spins;                  /**< @brief Spins in the sample */
+	size_t slices;                 /**< @brief Slices of a trajectory */
+	uint64_t hash;                 /**< @brief Run hash */
+	std::vector<size_t> done;      /**< @brief Processed spins */
+	std::vector<size_t> untouched; /**< @brief Spins not (completely) processed */
+	NDData<double> m;              /**< @brief 3 x done at t1, trajectories 3 x 1 at t */
+	NDData<double> times, data;    /**< @brief Recorder buffers (trajectories) */
+
+};
+
+
+/**
+ * @brief Periodic checkpoints of a run, one HDF5 file per run:
+ *
+ *        state          t0 t1 t dt spins slices m0 #done #untouched #samples
+ *                       hash (2 x 32 bit)
+ *        done           processed spins (sample runs)
+ *        untouched      spins left
+ *        m              magnetisation, 3 x done (trajectories 3 x 1 at t)
+ *        times, data    recorded steps (trajectories, as Recorder::Write)
+ *
+ *        Empty sets are not written. A run that completes removes its
+ *        checkpoint (Complete()).
+ *
+ *        Save() hands a snapshot to a writer thread and returns, the
+ *        integration goes on while it is written. A snapshot saved while
+ *        the writer is busy replaces the one waiting, if any. Snapshots are
+ *        written to fname.tmp and renamed over fname: a write cut short
+ *        leaves the previous checkpoint intact. HDF5 is not thread safe,
+ *        no other HDF5 I/O until Flush(). Before C++11 Save() writes
+ *        synchronously.
+ */
+class Checkpoint {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param fname     File
+	 * @param interval  Wall time between checkpoints [s]
+	 * @param restart   Runs resume from the file (else it is overwritten)
+	 */
+	Checkpoint (const std::string& fname, const double interval = 60.,
+			const bool restart = false) :
+		_fname(fname), _interval(interval), _restart(restart), _last(wtime_ns()), _saved(0)
+#if __cplusplus >= 201103L
+		, _pending(false), _busy(false), _stop(false)
+#endif
+		{}
+
+	~Checkpoint () {
+#if __cplusplus >= 201103L
+		{
+			std::unique_lock<std::mutex> lock (_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		if (_writer.joinable()) // Writes what is pending first
+			_writer.join();
+#endif
+	}
+
+	inline const std::string& File () const { return _fname; }
+
+	inline bool Restart () const { return _restart; }
+
+	/**
+	 * @brief Snapshots saved
+	 */
+	inline size_t Saved () const { return _saved; }
+
+	/**
+	 * @brief Interval passed since construction or the last Save()
+	 */
+	inline bool Due () const {
+		return 1.e-9 * (wtime_ns() - _last) >= _interval;
+	}
+
+	/**
+	 * @brief Save snapshot (asynchronously)
+	 */
+	void Save (const Snapshot& s) {
+		_last = wtime_ns();
+		++_saved;
+#if __cplusplus >= 201103L
+		std::unique_lock<std::mutex> lock (_mutex);
+		_next = s;
+		_pending = true;
+		if (!_writer.joinable())
+			_writer = std::thread (&Checkpoint::Run, this);
+		_cv.notify_all();
+#else
+		Write (s);
+#endif
+	}
+
+	/**
+	 * @brief Wait until saved snapshots are written
+	 */
+	void Flush () {
+#if __cplusplus >= 201103L
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (_pending || _busy)
+			_cv.wait (lock);
+#endif
+	}
+
+	/**
+	 * @brief The run completed: write nothing more, remove the checkpoint
+	 */
+	void Complete () {
+		Flush();
+		std::remove (_fname.c_str());
+	}
+
+	/**
+	 * @brief Load the last checkpoint
+	 *
+	 * @param s  Snapshot
+	 * @return   Success (false without file)
+	 */
+	bool Load (Snapshot& s) const {
+
+		if (!std::ifstream (_fname.c_str()))
+			return false;
+
+		try {
+			HDF5File f (_fname, IN);
+			NDData<double> state;
+			if (f.Read (state, "state") != codeare::io::OK || state.Size() != 14) {
+				std::cerr << "Checkpoint " << _fname << ": no state" << std::endl;
+				return false;
+			}
+			s.t0 = state[0]; s.t1 = state[1]; s.t = state[2]; s.dt = state[3];
+			s.spins  = (size_t) state[4];
+			s.slices = (size_t) state[5];
+			s.m0[0] = state[6]; s.m0[1] = state[7]; s.m0[2] = state[8];
+			s.hash = HashJoin (state[12], state[13]);
+			bool ok = Read (f, "done", (size_t) state[9], s.done) &&
+					Read (f, "untouched", (size_t) state[10], s.untouched);
+			if (ok && (s.done.size() || s.slices))
+				ok = f.Read (s.m, "m") == codeare::io::OK;
+			else
+				s.m = NDData<double>();
+			if (ok && state[11] > 0.)
+				ok = f.Read (s.times, "times") == codeare::io::OK &&
+						f.Read (s.data, "data") == codeare::io::OK;
+			else
+				s.times = s.data = NDData<double>();
+			fclose (f);
+			if (!ok)
+				std::cerr << "Checkpoint " << _fname << ": incomplete" << std::endl;
+			return ok;
+		} catch (const H5::Exception& e) {
+			std::cerr << "Checkpoint " << _fname << ": cannot read" << std::endl;
+			return false;
+		}
+
+	}
+
+private:
+
+	Checkpoint (const Checkpoint&);
+	Checkpoint& operator= (const Checkpoint&);
+
+	/** Write snapshot to fname.tmp, then rename over fname **/
+	bool Write (const Snapshot& s) const {
+
+		const std::string tmp = _fname + ".tmp";
+		bool ok = true;
+		{
+			HDF5File f (tmp, OUT);
+			NDData<double> state (14);
+			state[0] = s.t0; state[1] = s.t1; state[2] = s.t; state[3] = s.dt;
+			state[4] = s.spins; state[5] = s.slices;
+			state[6] = s.m0[0]; state[7] = s.m0[1]; state[8] = s.m0[2];
+			state[9] = s.done.size(); state[10] = s.untouched.size(); state[11] = s.times.Size();
+			state[12] = HashHigh (s.hash); state[13] = HashLow (s.hash);
+			ok = f.Write (state, "state") == codeare::io::OK &&
+					Write (f, "done", s.done) && Write (f, "untouched", s.untouched) &&
+					(s.m.Empty() || f.Write (s.m, "m") == codeare::io::OK);
+			if (ok && s.times.Size())
+				ok = f.Write (s.times, "times") == codeare::io::OK &&
+						f.Write (s.data, "data") == codeare::io::OK;
+			fclose (f);
+		}
+		if (!ok || std::rename (tmp.c_str(), _fname.c_str())) {
+			std::cerr << "Checkpoint " << _fname << ": write failed" << std::endl;
+			return false;
+		}
+		return true;
+
+	}
+
+	/** Indices as doubles (HDF5File writes floating point only) **/
+	static bool Write (HDF5File& f, const std::string& urn, const std::vector<size_t>& idx) {
+		if (idx.empty())
+			return true;
+		NDData<double> d (idx.size(), ALLOC_NOINIT);
+		for (size_t i = 0; i < idx.size(); ++i)
+			d[i] = idx[i];
+		return f.Write (d, urn) == codeare::io::OK;
+	}
+
+	static bool Read (HDF5File& f, const std::string& urn, const size_t n,
+			std::vector<size_t>& idx) {
+		idx.clear();
+		if (n == 0)
+			return true;
+		NDData<double> d;
+		if (f.Read (d, urn) != codeare::io::OK || d.Size() != n)
+			return false;
+		for (size_t i = 0; i < n; ++i)
+			idx.push_back ((size_t) d[i]);
+		return true;
+	}
+
+#if __cplusplus >= 201103L
+	/** Writer thread: latest pending snapshot, until stopped **/
+	void Run () {
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (true) {
+			while (!_pending && !_stop)
+				_cv.wait (lock);
+			if (!_pending)
+				return;
+			Snapshot s;
+			std::swap (s, _next);
+			_pending = false;
+			_busy = true;
+			lock.unlock();
+			Write (s);
+			lock.lock();
+			_busy = false;
+			_cv.notify_all();
+		}
+	}
+#endif
+
+	std::string _fname;
+	double _interval;
+	bool _restart;
+	uint64_t _last;
+	size_t _saved;
+
+#if __cplusplus >= 201103L
+	Snapshot _next;
+	bool _pending, _busy, _stop;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _writer;
+#endif
+
+};
+
+#endif /* CHECKPOINT_HPP_ */
@@ -15,6 +15,27 @@
 #include <algorithm>
 #include <numeric>
 #include <vector>
+#include <complex>
+
+#ifdef _OPENMP
+#    include <omp.h>
+#endif
+
+/**
+ * @brief Minimum number of elements for multithreaded element-wise
+ *        operations and reductions. Smaller data stays serial.
+ */
+#ifndef PAR_THRESHOLD
+#    define PAR_THRESHOLD 65536
+#endif
+
+/**
+ * @brief Block length of reductions. Fixed (i.e. independent of the thread
+ *        count) so that results are reproducible on any number of threads.
+ */
+#ifndef RED_BLOCK
+#    define RED_BLOCK 4096
+#endif
 
 #if defined (_MSC_VER) && _MSC_VER<1300
 #    define VECTOR_TYPE(A) std::vector<A>
@@ -34,6 +55,7 @@
 #            define ALIGNEMENT 16
 //#            warning "SSE2"
 #        endif
+#        define ALLOCATOR_TYPE(A) AlignmentAllocator<A,ALIGNEMENT>
 #        define VECTOR_TYPE(A) std::vector<A,AlignmentAllocator<A,ALIGNEMENT> >
 #        define VECTOR_CONSTR(A,B) std::vector<A,AlignmentAllocator<A,ALIGNEMENT> >(B)
 #        define VECTOR_CONSTR_VAL(A,B,C) std::vector<A,AlignmentAllocator<A,ALIGNEMENT> >(B,C)
@@ -63,6 +85,22 @@ public:
 	inline container () { _data = VECTOR_CONSTR (T,0); }
 	inline container (const size_t n) { assert(n>0); _data = VECTOR_CONSTR (T,n); }
 	inline container (const size_t n, const T t) { assert(n>0); _data = VECTOR_CONSTR_VAL (T,n,t); }
+	/**
+	 * @brief Empty container whose storage is allocated in given mode
+	 */
+	inline explicit container (const AllocMode mode) : _data(ALLOCATOR_TYPE(T)(mode)) {}
+	/**
+	 * @brief n elements allocated in given mode (ALLOC_NOINIT: uninitialised PODs)
+	 */
+	inline container (const size_t n, const AllocMode mode) : _data(ALLOCATOR_TYPE(T)(mode)) {
+		assert(n>0); _data.resize(n);
+	}
+	inline container (const container& c) : _data(c._data) {}
+	inline container& operator= (const container& c) { _data = c._data; return *this; }
+#if __cplusplus >= 201103L
+	inline container (container&& c) noexcept : _data(std::move(c._data)) {}
+	inline container& operator= (container&& c) noexcept { _data = std::move(c._data); return *this; }
+#endif
 	inline T& operator[] (const size_t n) { return _data[n]; }
 	inline T operator[] (const size_t n) const { return _data[n]; }
 	inline void operator= (const T t) {
@@ -77,7 +115,7 @@ public:
 	inline T at (const size_t n) const { return _data.at(n); }
 	inline const T* ptr (const size_t n = 0) const { return &_data[n]; }
 	inline T* ptr (const size_t n = 0)  { return &_data[n]; }
-	inline VECTOR_TYPE(T) data() const { return _data; }
+	inline const VECTOR_TYPE(T)& data() const { return _data; }
 	inline VECTOR_TYPE(T)& data() { return _data; }
 	inline size_t size() const { return _data.size(); }
 	inline ~container () {}
@@ -85,7 +123,8 @@ public:
 	inline iterator end() { return _data.end(); }
 	inline const_iterator begin() const { return _data.begin(); }
 	inline const_iterator end() const { return _data.end(); }
-	inline void resize (const size_t n, const T val = T()) { assert(n>0); _data.resize(n,val); }
+	inline void resize (const size_t n) { assert(n>0); _data.resize(n); }
+	inline void resize (const size_t n, const T val) { assert(n>0); _data.resize(n,val); }
 	inline void push_back (const T& t) { _data.push_back(t);}
 	inline void pop_back () {_data.pop_back(); }
 	inline bool empty () const { return _data.empty(); }
@@ -131,8 +170,97 @@ operator<< (std::ostream& os, const codeare::container<T>& ct) {
 template<class T> inline static T multiply (const T a, const T b) {
     return (a*b);
 }
+
+/**
+ * @brief Neumaier-compensated running sum
+ */
+template<class T> struct compensated {
+	T s, c;
+	compensated () : s(0), c(0) {}
+	inline void operator+= (const T x) {
+		T t = s + x;
+		if (fabs(s) >= fabs(x))
+			c += (s - t) + x;
+		else
+			c += (x - t) + s;
+		s = t;
+	}
+	inline void operator+= (const compensated& x) {
+		*this += x.s;
+		*this += x.c;
+	}
+	inline T value () const { return s + c; }
+};
+template<class T> struct compensated<std::complex<T> > {
+	compensated<T> re, im;
+	inline void operator+= (const std::complex<T> x) {
+		re += x.real();
+		im += x.imag();
+	}
+	inline void operator+= (const compensated& x) {
+		re += x.re;
+		im += x.im;
+	}
+	inline std::complex<T> value () const {
+		return std::complex<T>(re.value(), im.value());
+	}
+};
+
+/**
+ * @brief Blocked reduction: Each block of RED_BLOCK elements is reduced
+ *        serially by op.block, blocks (in parallel beyond PAR_THRESHOLD)
+ *        and then block results in order by op.combine.
+ *
+ * @param p   Data
+ * @param n   Number of elements
+ * @param op  Reduction with typedef result, block(p,n) and combine(a,b)
+ */
+template<class T, class Op> inline typename Op::result
+reduce (const T* p, const size_t n, const Op& op) {
+	const size_t nb = (n + RED_BLOCK - 1) / RED_BLOCK;
+	if (nb <= 1)
+		return op.block(p, n);
+	std::vector<typename Op::result> part (nb);
+#pragma omp parallel for schedule(static) if (n > PAR_THRESHOLD)
+	for (size_t b = 0; b < nb; ++b)
+		part[b] = op.block(p + b*RED_BLOCK, std::min((size_t)RED_BLOCK, n - b*RED_BLOCK));
+	typename Op::result ret = part[0];
+	for (size_t b = 1; b < nb; ++b)
+		ret = op.combine(ret, part[b]);
+	return ret;
+}
+
+template<class T> struct sum_op {
+	typedef compensated<T> result;
+	inline result block (const T* p, const size_t n) const {
+		result r;
+		for (size_t i = 0; i < n; ++i)
+			r += p[i];
+		return r;
+	}
+	inline result combine (result a, const result& b) const {
+		a += b;
+		return a;
+	}
+};
+
+template<class T> struct prod_op {
+	typedef T result;
+	inline result block (const T* p, const size_t n) const {
+		T r = (T)1;
+		for (size_t i = 0; i < n; ++i)
+			r *= p[i];
+		return r;
+	}
+	inline result combine (const result a, const result b) const {
+		return a*b;
+	}
+};
+
 template<class T> inline static T prod (const codeare::container<T>& ct) {
-	return std::accumulate(ct.begin(), ct.end(), (T)1, multiply<T>);
+	if (ct.empty())
+		return (T)1;
+	return reduce (ct.ptr(), ct.size(), prod_op<T>());
 }
 
 
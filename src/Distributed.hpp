@@ -0,0 +1,208 @@
+/*
+ * Distributed.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef DISTRIBUTED_HPP_
+#define DISTRIBUTED_HPP_
+
+#ifdef HAVE_CONFIG_H
+#    include "config.h"
+#endif
+
+#include "Container.hpp"
+#include "Simulation.hpp"
+
+#ifdef HAVE_MPI
+#    define OMPI_SKIP_MPICXX 1  // C++ bindings' namespace MPI clashes with paradigm MPI
+#    define MPICH_SKIP_MPICXX 1
+#    include <mpi.h>
+#endif
+
+#include <vector>
+
+/**
+ * @brief MPI environment. Initialises MPI for the lifetime of the first
+ *        instance (once per process, main thread makes MPI calls). Without
+ *        MPI compiled in, a single rank.
+ */
+class Communicator {
+
+public:
+
+	Communicator (int& argc, char**& argv) : _owner(false) {
+#ifdef HAVE_MPI
+		int initialised;
+		MPI_Initialized (&initialised);
+		if (!initialised) {
+			int provided;
+			MPI_Init_thread (&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+			_owner = true;
+		}
+#else
+		(void) argc;
+		(void) argv;
+#endif
+	}
+
+	~Communicator () {
+#ifdef HAVE_MPI
+		if (_owner)
+			MPI_Finalize ();
+#endif
+	}
+
+	inline static int Rank () {
+		int rank = 0;
+#ifdef HAVE_MPI
+		if (Initialised())
+			MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+#endif
+		return rank;
+	}
+
+	inline static int Size () {
+		int size = 1;
+#ifdef HAVE_MPI
+		if (Initialised())
+			MPI_Comm_size (MPI_COMM_WORLD, &size);
+#endif
+		return size;
+	}
+
+	inline static void Barrier () {
+#ifdef HAVE_MPI
+		if (Initialised())
+			MPI_Barrier (MPI_COMM_WORLD);
+#endif
+	}
+
+private:
+
+#ifdef HAVE_MPI
+	inline static bool Initialised () {
+		int initialised, finalised;
+		MPI_Initialized (&initialised);
+		MPI_Finalized (&finalised);
+		return initialised && !finalised;
+	}
+#endif
+
+	Communicator (const Communicator&);
+	Communicator& operator= (const Communicator&);
+
+	bool _owner;
+
+};
+
+
+/**
+ * @brief What rank 0 receives of a distributed simulation
+ */
+enum Collect {
+	GATHER, /**< @brief Final magnetisation of every spin (3 x spins) */
+	REDUCE  /**< @brief Signal: magnetisation summed over spins (3 x 1) */
+};
+
+/**
+ * @brief Contiguous shard [begin, end) of n items on rank of size ranks
+ */
+inline static void
+Shard (const size_t n, const int rank, const int size, size_t& begin, size_t& end) {
+	begin = n * rank / size;
+	end   = n * (rank + 1) / size;
+}
+
+/**
+ * @brief Sum magnetisation over spins (3 x spins -> 3 x 1)
+ */
+inline static NDData<double>
+SumSpins (const NDData<double>& m) {
+	NDData<double> s (3, 1);
+	const size_t n = m.Empty() ? 0 : m.Dim(1);
+	for (size_t j = 0; j < n; ++j)
+		for (size_t i = 0; i < 3; ++i)
+			s[i] += m(i,j);
+	return s;
+}
+
+/**
+ * @brief Simulate a sample in memory paradigm P. SHM: as Simulate(). MPI:
+ *        every rank simulates a contiguous shard of the sample (OpenMP
+ *        threads within), rank 0 gathers per spin results or reduces the
+ *        signal. All ranks must call with the same sample. Ranks other
+ *        than 0 return empty data. Checkpoints are single rank (ignored
+ *        with more).
+ *
+ * @param sample      Sample (all spins, on all ranks)
+ * @param env         Simulation environment
+ * @param m0          Initial magnetisation
+ * @param t0          Start time
+ * @param t1          End time
+ * @param config      Stepper configuration
+ * @param collect     Gather spins or reduce to signal
+ * @param checkpoint  Checkpoint (none: 0)
+ * @return            On rank 0: 3 x spins (GATHER) or 3 x 1 (REDUCE)
+ */
+template<paradigm P, class T> NDData<double>
+Simulate (Sample<T>& sample, const Bloch<T>& env, const state_type& m0, const double t0,
+		const double t1, const StepperConfig& config = StepperConfig(),
+		const Collect collect = GATHER, Checkpoint* checkpoint = 0) {
+
+	const int size = Communicator::Size();
+
+	if (P != MPI || size == 1) {
+		NDData<double> m = Simulate (sample, env, m0, t0, t1, config, checkpoint);
+		return (collect == GATHER) ? m : SumSpins (m);
+	}
+
+#ifdef HAVE_MPI
+	const int rank = Communicator::Rank();
+	const size_t n = sample.Size();
+	size_t begin, end;
+	Shard (n, rank, size, begin, end);
+
+	Sample<T> local;
+	for (size_t i = begin; i < end; ++i)
+		local.PushBack (sample[i]);
+	NDData<double> m;
+	if (local.Size())
+		m = Simulate (local, env, m0, t0, t1, config);
+
+	NDData<double> ret;
+	if (collect == REDUCE) {
+		NDData<double> s = SumSpins (m);
+		if (rank == 0)
+			ret = NDData<double> (3, 1);
+		MPI_Reduce (s.Ptr(), rank ? 0 : ret.Ptr(), 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	} else {
+		std::vector<int> counts (size), displs (size);
+		for (int r = 0; r < size; ++r) {
+			size_t b, e;
+			Shard (n, r, size, b, e);
+			counts[r] = 3 * (e - b);
+			displs[r] = 3 * b;
+		}
+		double dummy;
+		if (rank == 0)
+			ret = NDData<double> (3, n, ALLOC_NOINIT);
+		MPI_Gatherv (m.Empty() ? &dummy : m.Ptr(), counts[rank], MPI_DOUBLE,
+				rank ? 0 : ret.Ptr(), &counts[0], &displs[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	}
+
+	while (!sample.Done()) { // Processed, on some rank
+		size_t i;
+		sample.GetNext (i);
+		sample.TurnIn (i);
+	}
+
+	return ret;
+#else
+	return NDData<double>();
+#endif
+
+}
+
+#endif /* DISTRIBUTED_HPP_ */
@@ -0,0 +1,261 @@
+/*
+ * EPG.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef EPG_HPP_
+#define EPG_HPP_
+
+#include "Bloch.hpp"
+#include "Sample.hpp"
+#include "Stats.hpp"
+
+#include <boost/core/ref.hpp>
+#include <boost/numeric/odeint/integrate/null_observer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief Extended phase graph solver. A spin stands for a voxel whose
+ *        isochromats dephase uniformly by one full turn every dt (e.g.
+ *        crushers or readout in multi-echo spin and fast spin echo trains).
+ *        Its magnetisation is kept as configuration states F+_k, F-_k and
+ *        Z_k, k = 0 ... n, which advance on the grid t0 + j dt:
+ *
+ *        - Free interval dt: T1/T2 relaxation, off-resonance cs and
+ *          dephasing by one state
+ *        - RF: instantaneous rotation at the grid point within the pulse,
+ *          only hard pulses (flip angle GAMMA |scale| duration, phase of
+ *          scale), the same rotation Bloch<T> applies over the pulse
+ *
+ *        Cost grows with the square of the number of grid steps and not at
+ *        all with the number of isochromats. F+_0 and Z_0 are the voxel
+ *        signal, which Run() hands to observers as (mx, my, mz).
+ */
+template<class T> class EPG {
+
+	typedef std::complex<double> CD;
+
+	/** Rotation of (F+_k, F-_k, Z_k) at grid step, column major **/
+	struct Pulse {
+		size_t step;
+		CD R[9];
+		bool operator< (const Pulse& p) const { return step < p.step; }
+	};
+
+public:
+
+	/**
+	 * @brief Construct from the events of a simulation environment
+	 *
+	 * @param events  RF events (Bloch<T>::GetEvents())
+	 * @param dt      Dephasing period, grid step [s]
+	 * @param t0      Start time, grid origin
+	 */
+	EPG (const std::vector<const RF<T>*>& events, const double dt, const double t0 = 0.) :
+		_dt(dt), _t0(t0), _valid(dt > 0.) {
+		if (!_valid) {
+			std::cerr << "EPG: dephasing period must be positive" << std::endl;
+			return;
+		}
+		for (size_t i = 0; i < events.size(); ++i) {
+			const RF<T>& rf = *events[i];
+			const double start = rf.TPOIs().front(), end = rf.TPOIs().back();
+			if (rf.Type() != HARD_RF) {
+				std::cerr << "EPG: only hard pulses, event " << i << " is not" << std::endl;
+				_valid = false;
+				continue;
+			}
+			if (rf.Duration() <= 0. || end < t0) // Nothing or not within
+				continue;
+			double j = std::floor ((.5*(start+end) - t0)/dt + .5);
+			if (j < 0.)
+				j = 0.;
+			const double tj = t0 + j*dt;
+			if (tj < start - 1.e-9*dt || tj > end + 1.e-9*dt) {
+				std::cerr << "EPG: no grid point (dt " << dt << ") within pulse " << i
+						  << " [" << start << ", " << end << "]" << std::endl;
+				_valid = false;
+				continue;
+			}
+			Pulse p;
+			p.step = (size_t) j;
+			Rotation (rf((start+end)*.5) * (T)rf.Duration(), p.R);
+			_pulses.push_back (p);
+		}
+		std::stable_sort (_pulses.begin(), _pulses.end());
+	}
+
+	/**
+	 * @brief All events are hard pulses with a grid point within
+	 */
+	inline bool Valid () const { return _valid; }
+
+	/**
+	 * @brief Grid steps from t0 to t (rounded to the grid)
+	 */
+	inline size_t Steps (const double t) const {
+		return (t > _t0) ? (size_t) std::floor ((t - _t0)/_dt + .5) : 0;
+	}
+
+	/**
+	 * @brief Evolve one voxel from t0 to t1 (rounded to the grid)
+	 *
+	 * @param spin  Spin (pd, T1, T2, cs)
+	 * @param m     Voxel magnetisation (in: initial, all isochromats in
+	 *              phase; out: final signal)
+	 * @param t1    End time
+	 * @param obs   Observer (called with (m,t) at every grid point after
+	 *              the pulses there)
+	 * @return      Number of grid steps
+	 */
+	template<class Observer> size_t
+	Run (const Spin<T>& spin, state_type& m, const double t1, Observer obs) const {
+
+		assert (_valid);
+		const size_t n = Steps (t1);
+		std::vector<CD> fp (n+2, CD(0.,0.)), fm (n+2, CD(0.,0.)), z (n+1, CD(0.,0.));
+		fp[0] = CD(m[0], m[1]);
+		fm[0] = std::conj(fp[0]);
+		z[0]  = m[2];
+
+		const double e1 = std::exp(-_dt/spin.t1()), e2 = std::exp(-_dt/spin.t2());
+		const CD     ep = e2 * std::polar (1., -spin.cs()*_dt), em = std::conj(ep);
+		const double recovery = spin.pd() * (1. - e1);
+
+		size_t p = 0, updates = 0; // Next pulse
+		for (size_t j = 0; ; ++j) {
+
+			// States in use: dephased up to j, only those that can still
+			// refocus to k = 0 by step n
+			const size_t a = std::min (j, n - j) + 1;
+			updates += a;
+
+			for (; p < _pulses.size() && _pulses[p].step == j; ++p) {
+				const CD* R = _pulses[p].R;
+				for (size_t i = 0; i < a; ++i) {
+					const CD x = fp[i], y = fm[i], w = z[i];
+					fp[i] = Mul(R[0],x) + Mul(R[3],y) + Mul(R[6],w);
+					fm[i] = Mul(R[1],x) + Mul(R[4],y) + Mul(R[7],w);
+					z[i]  = Mul(R[2],x) + Mul(R[5],y) + Mul(R[8],w);
+				}
+			}
+
+			state_type s = {{ real(fp[0]), imag(fp[0]), real(z[0]) }};
+			boost::unwrap_ref(obs) (s, _t0 + j*_dt);
+			if (j == n) {
+				m = s;
+				break;
+			}
+
+			for (size_t i = 0; i < a; ++i) { // Relaxation and off-resonance
+				fp[i] = Mul(fp[i],ep);
+				fm[i] = Mul(fm[i],em);
+				z[i] *= e1;
+			}
+			z[0] += recovery;
+
+			// Dephasing: F+_k <- F+_k-1, F-_k <- F-_k+1. States beyond a
+			// were never populated (zero) or are no longer needed.
+			const size_t b = std::min (j+1, n-j-1) + 1;
+			for (size_t i = b-1; i > 0; --i)
+				fp[i] = fp[i-1];
+			fp[0] = std::conj(fm[1]);
+			for (size_t i = 0; i < b; ++i)
+				fm[i] = fm[i+1];
+
+		}
+
+		STATS_ADD(EPG_STATES, updates);
+		return n;
+
+	}
+
+	/**
+	 * @brief Simulate all spins (voxels) of a sample from t0 to t1, spins
+	 *        distributed over threads
+	 *
+	 * @param sample  Sample (processed spins are turned in)
+	 * @param m0      Initial magnetisation
+	 * @param t1      End time
+	 * @return        Final magnetisation (3 x spins)
+	 */
+	NDData<double> Simulate (Sample<T>& sample, const state_type& m0, const double t1) const {
+
+		NDData<double> m (3, sample.Size(), ALLOC_NOINIT);
+
+#pragma omp parallel
+		while (true) {
+
+			size_t n = 0;
+			const Spin<T>* spin = 0;
+#pragma omp critical (sample)
+			if (!sample.Done())
+				spin = &sample.GetNext(n);
+			if (!spin)
+				break;
+
+			state_type x = m0;
+			Run (*spin, x, t1, boost::numeric::odeint::null_observer());
+			m(0,n) = x[0];
+			m(1,n) = x[1];
+			m(2,n) = x[2];
+
+#pragma omp critical (sample)
+			sample.TurnIn (n);
+			STATS_INC(SPINS);
+
+		}
+
+		return m;
+
+	}
+
+private:
+
+	/**
+	 * @brief a*b without the inf/nan recovery of complex operator* (a
+	 *        library call per product unless -fcx-limited-range)
+	 */
+	inline static CD Mul (const CD& a, const CD& b) {
+		return CD (real(a)*real(b) - imag(a)*imag(b), real(a)*imag(b) + imag(a)*real(b));
+	}
+
+	/**
+	 * @brief Rotation of (F+, F-, Z) by a hard pulse of area a = scale *
+	 *        duration. R3 is the rotation of (mx, my, mz) Bloch<T> applies
+	 *        over the pulse, in configuration states R = P R3 P^-1 with
+	 *        F+ = mx + i my, F- = mx - i my.
+	 */
+	static void Rotation (const std::complex<T> a, CD* R) {
+
+		boost::array<double,9> R3;
+		rotation_matrix (GAMMA*real(a), GAMMA*imag(a), 0., 1., R3);
+
+		const CD I (0.,1.);
+		const CD P[3][3]  = {{ 1.,  I, 0. }, { 1., -I, 0. }, { 0., 0., 1. }};
+		const CD Pi[3][3] = {{ .5, .5, 0. }, { -.5*I, .5*I, 0. }, { 0., 0., 1. }};
+		for (size_t i = 0; i < 3; ++i)
+			for (size_t j = 0; j < 3; ++j) {
+				CD r = 0.;
+				for (size_t k = 0; k < 3; ++k)
+					for (size_t l = 0; l < 3; ++l)
+						r += P[i][k] * R3[k+3*l] * Pi[l][j];
+				R[i+3*j] = r;
+			}
+
+	}
+
+	std::vector<Pulse> _pulses;
+	double _dt, _t0;
+	bool _valid;
+
+};
+
+#endif /* EPG_HPP_ */
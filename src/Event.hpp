@@ -13,9 +13,32 @@
 
 #include <boost/tuple/tuple.hpp>
 
-enum EventType {NONE_E = -1, RF_E, GRADIENT_E};
+#include <stdint.h>
+
+enum EventType {NONE_E = -1, RF_E, GRADIENT_E, SPOILER_E};
 
 const static double TWOPI = 6.283185307179586476925286766559005768394338798750211641949889185;
+const double GAMMA = 4.2577480e7;
+
+/**
+ * @brief FNV-1a hash of n bytes at p, continuing h
+ */
+inline static uint64_t
+fnv1a (const void* p, const size_t n, uint64_t h = 14695981039346656037ULL) {
+	const unsigned char* c = (const unsigned char*) p;
+	for (size_t i = 0; i < n; ++i)
+		h = (h ^ c[i]) * 1099511628211ULL;
+	return h;
+}
+
+/**
+ * @brief 64 bit hashes as 2 exact doubles (HDF5File writes floating point only)
+ */
+inline static double HashHigh (const uint64_t h) { return (double) (h >> 32); }
+inline static double HashLow (const uint64_t h) { return (double) (h & 0xffffffffULL); }
+inline static uint64_t HashJoin (const double hi, const double lo) {
+	return ((uint64_t) hi << 32) | (uint64_t) lo;
+}
 
 template<class T> class RF;
 template<class T> class Gradient;
@@ -44,6 +67,14 @@ public:
 		return (t >= _tpois.front() && t <= _tpois.back());
 	}
 
+	/**
+	 * @brief Hash of event type and times
+	 */
+	uint64_t Hash () const {
+		uint64_t h = fnv1a (&_etype, sizeof(_etype));
+		return _tpois.empty() ? h : fnv1a (&_tpois[0], _tpois.size()*sizeof(double), h);
+	}
+
 protected:
 
 	std::vector<double> _tpois;
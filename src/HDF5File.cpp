@@ -22,7 +22,7 @@ const IOStatus HDF5File::Close () {
 const IOStatus HDF5File::ReportException (const H5::Exception& e, const IOStatus ios) {
 	e.printError();
 	_status = ios;
-	std::cout << StatusMessage[_status] << std::endl;
+	std::cerr << StatusMessage[_status] << std::endl;
 	return _status;
 }
 
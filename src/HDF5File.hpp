@@ -27,7 +27,9 @@
 //#define VERBOSE
 
 #include "NDData.hpp"
+#include "SplitNDData.hpp"
 #include "File.hpp"
+#include "Stats.hpp"
 
 #include <H5Cpp.h>
 #include <algorithm>
@@ -107,10 +109,12 @@ public:
 			H5::Exception::dontPrint();
 #endif
 
+			ArenaScope scope;
 			H5::Group group;
 			bool Complex = H5Traits<T>::Complex;
 
-			codeare::container<hsize_t> dims ((codeare::container<hsize_t>) data.Dims());
+			codeare::container<hsize_t> dims (data.NDim(), ALLOC_ARENA);
+			std::copy (data.Dims().begin(), data.Dims().end(), dims.begin());
 			if (Complex)
 				dims.insert(dims.begin(), 2);
 			std::reverse (dims.begin(),dims.end());
@@ -129,6 +133,7 @@ public:
 			H5::DataSet   dset = group.createDataSet(urn, dtype, dspace);
 
 			dset.write(data.Ptr(), dtype);
+			STATS_ADD(BYTES_WRITTEN, data.Size()*sizeof(T));
 			dset.close();
 			dspace.close();
 			group.close();
@@ -153,6 +158,187 @@ public:
 		return Write(data, std::string(urn), std::string(url));
 	}
 
+	/**
+	 * @brief     Create a chunked 1D data set of n elements, to be filled
+	 *            by WritePart(). Same layout as Write() of NDData<T>(n).
+	 *
+	 * @param  urn   Data set name
+	 * @param  n     Number of elements
+	 * @param  url   Group
+	 * @param  chunk Elements per chunk
+	 */
+	template<class T> IOStatus
+	Create (const std::string& urn, const size_t n, const std::string& url = "/",
+			const size_t chunk = 65536) {
+
+		try {
+
+#ifndef VERBOSE
+			H5::Exception::dontPrint();
+#endif
+
+			H5::Group group;
+			const bool Complex = H5Traits<T>::Complex;
+			const int  rank = Complex ? 2 : 1;
+			hsize_t dims[2] = { n, 2 }, cdims[2] = { std::min(chunk, n), 2 };
+
+			try {
+				group = this->_file.openGroup(url);
+			} catch (const H5::Exception& e) {
+				group = this->CreateGroup (url);
+			}
+
+			H5::DSetCreatPropList plist;
+			plist.setChunk (rank, cdims);
+			H5::DataSpace dspace (rank, dims);
+			H5::FloatType dtype  (H5Traits<T>::H5Type());
+			H5::DataSet   dset = group.createDataSet(urn, dtype, dspace, plist);
+
+			dset.close();
+			dspace.close();
+			group.close();
+
+		} catch (const H5::FileIException&      e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::GroupIException&     e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::DataSetIException&   e) {
+			return ReportException (e, HDF5_DATASET_I_EXCEPTION);
+		} catch (const H5::DataSpaceIException& e) {
+			return ReportException (e, HDF5_DATASPACE_I_EXCEPTION);
+		} catch (const H5::PropListIException&  e) {
+			return ReportException (e, HDF5_DATASET_I_EXCEPTION);
+		}
+
+		return OK;
+
+	}
+
+	/**
+	 * @brief     Write elements [offset, offset+n) of a data set made by
+	 *            Create()
+	 *
+	 * @param  data   n elements
+	 * @param  offset First element
+	 * @param  n      Number of elements
+	 * @param  urn    Data set name
+	 * @param  url    Group
+	 */
+	template<class T> IOStatus
+	WritePart (const T* data, const size_t offset, const size_t n, const std::string& urn,
+			const std::string& url = "/") {
+
+		try {
+
+#ifndef VERBOSE
+			H5::Exception::dontPrint();
+#endif
+
+			const bool Complex = H5Traits<T>::Complex;
+			const int  rank = Complex ? 2 : 1;
+			hsize_t start[2] = { offset, 0 }, count[2] = { n, 2 };
+
+			H5::DataSet   dset   = this->_file.openDataSet(URI(url,urn));
+			H5::DataSpace fspace = dset.getSpace();
+			fspace.selectHyperslab (H5S_SELECT_SET, count, start);
+			H5::DataSpace mspace (rank, count);
+			H5::FloatType dtype  (H5Traits<T>::H5Type());
+
+			dset.write(data, dtype, mspace, fspace);
+			STATS_ADD(BYTES_WRITTEN, n*sizeof(T));
+			mspace.close();
+			fspace.close();
+			dset.close();
+
+		} catch (const H5::FileIException&      e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::DataSetIException&   e) {
+			return ReportException (e, HDF5_DATASET_I_EXCEPTION);
+		} catch (const H5::DataSpaceIException& e) {
+			return ReportException (e, HDF5_DATASPACE_I_EXCEPTION);
+		} catch (const H5::DataTypeIException&  e) {
+			return ReportException (e, HDF5_DATATYPE_I_EXCEPTION);
+		}
+
+		return OK;
+
+	}
+
+	/**
+	 * @brief     Write split complex data. The file layout is identical to
+	 *            that of interleaved complex data. Each plane is written
+	 *            directly through a strided file selection, i.e. no
+	 *            interleaved copy is made.
+	 *
+	 * @param  data Split complex data
+	 */
+	template<class T> IOStatus
+	Write (const SplitNDData<T>& data, const std::string& urn, const std::string& url = "/") {
+
+		try {
+
+#ifndef VERBOSE
+			H5::Exception::dontPrint();
+#endif
+
+			ArenaScope scope;
+			H5::Group group;
+			size_t nd = data.NDim() + 1;
+
+			codeare::container<hsize_t> dims (nd, ALLOC_ARENA);
+			dims[0] = 2;
+			std::copy (data.Dims().begin(), data.Dims().end(), dims.begin()+1);
+			std::reverse (dims.begin(),dims.end());
+
+			try {
+				group = this->_file.openGroup(url);
+			} catch (const H5::Exception& e) {
+				group = this->CreateGroup (url);
+			}
+
+			H5::DataSpace dspace (nd, dims.ptr());
+			H5::FloatType dtype  (H5Traits<T>::H5Type());
+			H5::DataSet   dset = group.createDataSet(urn, dtype, dspace);
+
+			hsize_t n = data.Size();
+			H5::DataSpace mspace (1, &n);
+			codeare::container<hsize_t> start (nd, ALLOC_ARENA), stride (nd, ALLOC_ARENA);
+			stride = 1;
+			stride[nd-1] = 2;
+			dims[nd-1] = 1;
+
+			for (size_t p = 0; p < 2; ++p) {
+				start[nd-1] = p;
+				dspace.selectHyperslab (H5S_SELECT_SET, dims.ptr(), start.ptr(), stride.ptr());
+				dset.write ((p ? data.Imag() : data.Real()).Ptr(), dtype, mspace, dspace);
+			}
+			STATS_ADD(BYTES_WRITTEN, 2*data.Size()*sizeof(T));
+
+			mspace.close();
+			dset.close();
+			dspace.close();
+			group.close();
+
+		} catch (const H5::FileIException&      e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::GroupIException&     e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::DataSetIException&   e) {
+			return ReportException (e, HDF5_DATASET_I_EXCEPTION);
+		} catch (const H5::DataSpaceIException& e) {
+			return ReportException (e, HDF5_DATASPACE_I_EXCEPTION);
+		} catch (const H5::DataTypeIException&  e) {
+			return ReportException (e, HDF5_DATATYPE_I_EXCEPTION);
+		}
+
+		return OK;
+
+	}
+	template<class T> IOStatus
+	Write (const SplitNDData<T>& data, const char* urn, const char* url = "/") {
+		return Write(data, std::string(urn), std::string(url));
+	}
+
 
 	template<class T> IOStatus
 	Read (NDData<T>& data, const std::string& urn, const std::string& url = "/") {
@@ -168,12 +354,13 @@ public:
 			bool Complex = H5Traits<T>::Complex;
 			size_t ndims = dspace.getSimpleExtentNdims();
 
-			codeare::container<hsize_t> dims (ndims);
+			ArenaScope scope;
+			codeare::container<hsize_t> dims (ndims, ALLOC_ARENA);
 			size_t ndim  = dspace.getSimpleExtentDims(&dims[0], NULL);
 			if (Complex)
 				dims.pop_back();
 			std::reverse (dims.begin(),dims.end());
-			data         = NDData<T> ((codeare::container<size_t>)dims);
+			data         = NDData<T> ((codeare::container<size_t>)dims, ALLOC_NOINIT);
 
 			dset.read(data.Ptr(), dtype);
 			dspace.close();
@@ -196,6 +383,68 @@ public:
 	Read (NDData<T>& data, const char* urn, const char* url = "/") {
 		return Read(data, std::string(urn), std::string(url));
 	}
+
+	/**
+	 * @brief     Read complex data set straight into split planes
+	 *
+	 * @param  data Split complex data
+	 */
+	template<class T> IOStatus
+	Read (SplitNDData<T>& data, const std::string& urn, const std::string& url = "/") {
+
+		try {
+
+#ifndef VERBOSE
+			H5::Exception::dontPrint();
+#endif
+			H5::DataSet   dset   = this->_file.openDataSet(URI(url,urn));
+			H5::FloatType dtype  (H5Traits<T>::H5Type());
+			H5::DataSpace dspace = dset.getSpace();
+			size_t nd = dspace.getSimpleExtentNdims();
+
+			ArenaScope scope;
+			codeare::container<hsize_t> dims (nd, ALLOC_ARENA),
+				start (nd, ALLOC_ARENA), stride (nd, ALLOC_ARENA);
+			dspace.getSimpleExtentDims(&dims[0], NULL);
+			assert (dims[nd-1] == 2);
+
+			codeare::container<size_t> ddims (nd-1);
+			std::reverse_copy (dims.begin(), dims.end()-1, ddims.begin());
+			data = SplitNDData<T> (ddims, ALLOC_NOINIT);
+
+			hsize_t n = data.Size();
+			H5::DataSpace mspace (1, &n);
+			stride = 1;
+			stride[nd-1] = 2;
+			dims[nd-1] = 1;
+
+			for (size_t p = 0; p < 2; ++p) {
+				start[nd-1] = p;
+				dspace.selectHyperslab (H5S_SELECT_SET, dims.ptr(), start.ptr(), stride.ptr());
+				dset.read ((p ? data.Imag() : data.Real()).Ptr(), dtype, mspace, dspace);
+			}
+
+			mspace.close();
+			dspace.close();
+			dset.close();
+
+		} catch (const H5::FileIException&      e) {
+			return ReportException (e, HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::DataSetIException&   e) {
+			return ReportException (e, HDF5_DATASET_I_EXCEPTION);
+		} catch (const H5::DataSpaceIException& e) {
+			return ReportException (e, HDF5_DATASPACE_I_EXCEPTION);
+		} catch (const H5::DataTypeIException&  e) {
+			return ReportException (e, HDF5_DATATYPE_I_EXCEPTION);
+		}
+
+		return OK;
+
+	}
+	template<class T> IOStatus
+	Read (SplitNDData<T>& data, const char* urn, const char* url = "/") {
+		return Read(data, std::string(urn), std::string(url));
+	}
     template<class T> NDData<T>
     Read (const std::string& urn, const std::string& url = "/") {
         NDData<T> ret;
@@ -28,6 +28,16 @@ public:
 				this->_scale : CT(0., 0.);
 	}
 
+	void Evaluate (const double* t, const size_t n, CT* out) const {
+		const bool on = this->Duration() > 0.;
+		for (size_t i = 0; i < n; ++i)
+			out[i] = (on && this->Active(t[i])) ? this->_scale : CT(0., 0.);
+	}
+
+	CT Derivative (double) const {
+		return CT(0., 0.); // Constant within, edges are not differentiable
+	}
+
 };
 
 
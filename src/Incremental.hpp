@@ -0,0 +1,239 @@
+/*
+ * Incremental.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef INCREMENTAL_HPP_
+#define INCREMENTAL_HPP_
+
+#include "Bloch.hpp"
+#include "HDF5File.hpp"
+#include "Sample.hpp"
+#include "Simulation.hpp"
+#include "Stats.hpp"
+#include "Stepper.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Incremental re-simulation of a sample: the state of every spin at
+ *        every event boundary (TPOIs of the RF events, spoiler times) is
+ *        kept with hashes of the run and its events. A re-run finds the
+ *        earliest start of an event added, removed or changed and resumes
+ *        all spins from the last boundary before it. Editing events near
+ *        the end of a long sequence re-simulates only its end.
+ *
+ *        Repeat blocks and repeated spoilers count per repetition: every
+ *        repetition start is a boundary with a hash of its own (see
+ *        RepeatRF::HashRepetition()), so e.g. changing the phase table
+ *        from repetition k on resumes at repetition k. Boundaries and
+ *        states grow with the repetitions.
+ *
+ *        Every segment between boundaries is integrated from config.dt,
+ *        a resumed run gives bit for bit the result of a full one. States
+ *        take 3 x spins x boundaries doubles, in memory and in the file:
+ *
+ *        run     hash of spins, m0, t0 and stepper (2 x 32 bit), events
+ *        times   boundaries, t0 ... t1
+ *        events  start and hash (2 x 32 bit) of every event (3 x events)
+ *        m       states (3 x spins x boundaries)
+ */
+template<class T> class Incremental {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param fname  State file (none: memory only, e.g. for a server)
+	 */
+	Incremental (const std::string& fname = "") :
+		_fname(fname), _run(0), _loaded(false), _resumed(0.), _segments(0) {}
+
+	/**
+	 * @brief Simulate all spins of a sample from t0 to t1 (see Simulate()),
+	 *        resuming from the states of the previous run where its events
+	 *        are unchanged
+	 *
+	 * @param sample  Sample (processed spins are turned in)
+	 * @param env     Simulation environment (events)
+	 * @param m0      Initial magnetisation
+	 * @param t0      Start time
+	 * @param t1      End time
+	 * @param config  Stepper configuration
+	 * @return        Final magnetisation (3 x spins)
+	 */
+	NDData<double> Simulate (Sample<T>& sample, const Bloch<T>& env, const state_type& m0,
+			const double t0, const double t1, const StepperConfig& config = StepperConfig()) {
+
+		const size_t n = sample.Size();
+		const uint64_t run = RunHash (sample, m0, t0, config);
+		std::vector<double> times;
+		std::vector<std::pair<double,uint64_t> > events;
+		Boundaries (env, t0, t1, times, events);
+
+		if (!_loaded)
+			_loaded = Load();
+
+		/** Last boundary before the earliest changed event **/
+		size_t k = 0;
+		const size_t K = times.size();
+		if (_loaded && run == _run && _m.Dim(1) == n) {
+			std::vector<std::pair<double,uint64_t> > changed;
+			std::set_symmetric_difference (events.begin(), events.end(),
+					_events.begin(), _events.end(), std::back_inserter (changed));
+			const double tau = changed.empty() ?
+					std::numeric_limits<double>::infinity() : changed.front().first;
+			const size_t common = std::min (K, _times.size());
+			while (k+1 < common && times[k+1] == _times[k+1] && times[k+1] < tau)
+				++k;
+		}
+		_resumed = times[k];
+		_segments = K-1-k;
+
+		if (k == 0 || _m.Dim(2) != K) { // New layout, keep unchanged states
+			NDData<double> m (3, n, K);
+			for (size_t j = 0; j <= k; ++j)
+				for (size_t i = 0; i < n; ++i)
+					for (size_t c = 0; c < 3; ++c)
+						m(c,i,j) = (k > 0) ? _m(c,i,j) : m0[c];
+			_m = m;
+		}
+		NDData<double>& m = _m;
+
+#pragma omp parallel
+		{
+			Bloch<T>& local = Bloch<T>::Instance();
+			if (&local != &env)
+				local = env;
+#pragma omp barrier
+
+			while (true) {
+
+				size_t i = 0;
+				const Spin<T>* spin = 0;
+#pragma omp critical (sample)
+				if (!sample.Done())
+					spin = &sample.GetNext(i);
+				if (!spin)
+					break;
+
+				STATS_TIMER(timer);
+				local.SetSpin (*spin);
+				state_type x = {{ m(0,i,k), m(1,i,k), m(2,i,k) }};
+				for (size_t j = k; j+1 < K; ++j) {
+					Integrate<T> (config, x, times[j], times[j+1],
+							boost::numeric::odeint::null_observer());
+					m(0,i,j+1) = x[0];
+					m(1,i,j+1) = x[1];
+					m(2,i,j+1) = x[2];
+				}
+
+#pragma omp critical (sample)
+				sample.TurnIn (i);
+				STATS_INC(SPINS);
+				STATS_ADD(SPIN_NS, timer.Lap());
+
+			}
+		}
+
+		_run = run;
+		_times.swap (times);
+		_events.swap (events);
+		_loaded = true;
+		Save();
+
+		NDData<double> ret (3, n, ALLOC_NOINIT);
+		for (size_t i = 0; i < n; ++i)
+			for (size_t c = 0; c < 3; ++c)
+				ret(c,i) = m(c,i,K-1);
+		return ret;
+
+	}
+
+	/**
+	 * @brief Boundary the last Simulate() resumed from (t0: full run)
+	 */
+	inline double Resumed () const { return _resumed; }
+
+	/**
+	 * @brief Segments per spin integrated by the last Simulate()
+	 */
+	inline size_t Segments () const { return _segments; }
+
+private:
+
+	bool Load () {
+		if (_fname.empty() || !std::ifstream (_fname.c_str()))
+			return false;
+		try {
+			HDF5File f (_fname, IN);
+			NDData<double> run, times, events;
+			bool ok = f.Read (run, "run") == codeare::io::OK && run.Size() == 3 &&
+					f.Read (times, "times") == codeare::io::OK &&
+					f.Read (_m, "m") == codeare::io::OK && _m.NDim() == 3 &&
+					_m.Dim(2) == times.Size();
+			if (ok && run[2] > 0.)
+				ok = f.Read (events, "events") == codeare::io::OK && events.Size() == 3*run[2];
+			fclose (f);
+			if (!ok) {
+				std::cerr << "Incremental " << _fname << ": unreadable, full run" << std::endl;
+				return false;
+			}
+			_run = HashJoin (run[0], run[1]);
+			_times.assign (times.Ptr(), times.Ptr() + times.Size());
+			_events.clear();
+			for (size_t e = 0; e < events.Size()/3; ++e)
+				_events.push_back (std::make_pair (events(0,e), HashJoin (events(1,e), events(2,e))));
+			return true;
+		} catch (const H5::Exception& e) {
+			std::cerr << "Incremental " << _fname << ": unreadable, full run" << std::endl;
+			return false;
+		}
+	}
+
+	void Save () const {
+		if (_fname.empty())
+			return;
+		HDF5File f (_fname, OUT);
+		NDData<double> run (3), times (_times.size(), ALLOC_NOINIT);
+		run[0] = HashHigh (_run);
+		run[1] = HashLow (_run);
+		run[2] = _events.size();
+		std::copy (_times.begin(), _times.end(), times.Ptr());
+		f.Write (run, "run");
+		f.Write (times, "times");
+		if (!_events.empty()) {
+			NDData<double> events (3, _events.size(), ALLOC_NOINIT);
+			for (size_t e = 0; e < _events.size(); ++e) {
+				events(0,e) = _events[e].first;
+				events(1,e) = HashHigh (_events[e].second);
+				events(2,e) = HashLow (_events[e].second);
+			}
+			f.Write (events, "events");
+		}
+		f.Write (_m, "m");
+		fclose (f);
+	}
+
+	std::string _fname;
+	uint64_t _run;
+	std::vector<double> _times;
+	std::vector<std::pair<double,uint64_t> > _events;
+	NDData<double> _m;
+	bool _loaded;
+	double _resumed;
+	size_t _segments;
+
+};
+
+#endif /* INCREMENTAL_HPP_ */
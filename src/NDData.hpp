@@ -21,22 +21,156 @@ operator<< (std::ostream& os, const T_minmax<T>& mm) {
 	return os << "[" << mm.min << ", " << mm.max << "]";
 }
 
+/**
+ * @brief Compensated sum, reproducible for any thread count
+ */
 template<class T> inline static T
 sum (const codeare::container<T>& v) {
-	return std::accumulate(v.begin(), v.end(), (T)0);
+	if (v.empty())
+		return (T)0;
+	return reduce (v.ptr(), v.size(), sum_op<T>()).value();
 }
 
+template<class T> struct minmax_op {
+	typedef T_minmax<T> result;
+	inline result block (const T* p, const size_t n) const {
+		result r;
+		r.min = p[0];
+		r.max = p[0];
+		for (size_t i = 1; i < n; ++i) {
+			r.min = std::min(r.min,p[i]);
+			r.max = std::max(r.max,p[i]);
+		}
+		return r;
+	}
+	inline result combine (result a, const result& b) const {
+		a.min = std::min(a.min,b.min);
+		a.max = std::max(a.max,b.max);
+		return a;
+	}
+};
+
 template<class T> inline const T_minmax<T>
 minmax (const codeare::container<T>& v) {
-	T_minmax<T> ret;
-	for (size_t i = 0; i < v.size(); ++i){
-		ret.min = std::min(ret.min,v[i]);
-		ret.max = std::max(ret.max,v[i]);
+	if (v.empty()) {
+		T_minmax<T> ret;
+		ret.min = ret.max = T();
+		return ret;
 	}
-	return ret;
+	return reduce (v.ptr(), v.size(), minmax_op<T>());
 }
 
 
+/**
+ * @brief  Strided view on nd-data. Does not own its data.
+ *         Valid as long as the viewed NDData is neither resized nor destroyed.
+ */
+template<class T>
+class NDView {
+
+public:
+
+	/**
+	 * @brief Construct view
+	 *
+	 * @param ptr     First element
+	 * @param dims    Side lengths
+	 * @param strides Element strides per dimension
+	 */
+	NDView (T* ptr, const codeare::container<size_t>& dims,
+			const codeare::container<size_t>& strides) :
+		_ptr(ptr), _dims(dims), _strd(strides) {}
+
+	inline size_t Dim (const size_t n = 0) const { return _dims[n]; }
+	inline const codeare::container<size_t>& Dims () const { return _dims; }
+	inline const codeare::container<size_t>& Strides () const { return _strd; }
+	inline size_t NDim () const { return _dims.size(); }
+	inline size_t Size () const { return _dims.empty() ? 0 : prod(_dims); }
+
+	/**
+	 * @brief Contiguous in memory (i.e. plain pointer arithmetic possible)?
+	 */
+	inline bool Contiguous () const {
+		size_t s = 1;
+		for (size_t i = 0; i < _dims.size(); ++i) {
+			if (_dims[i] > 1 && _strd[i] != s)
+				return false;
+			s *= _dims[i];
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Linear (column major) element access
+	 */
+	inline T& operator[] (size_t p) const {
+		size_t off = 0;
+		for (size_t i = 0; i < _dims.size(); ++i) {
+			off += (p % _dims[i]) * _strd[i];
+			p   /= _dims[i];
+		}
+		return _ptr[off];
+	}
+
+	inline T& operator() (const size_t n0) const { return _ptr[n0*_strd[0]]; }
+	inline T& operator() (const size_t n0, const size_t n1) const
+		{ return _ptr[n0*_strd[0] + n1*_strd[1]]; }
+	inline T& operator() (const size_t n0, const size_t n1, const size_t n2) const
+		{ return _ptr[n0*_strd[0] + n1*_strd[1] + n2*_strd[2]]; }
+
+	inline T* Ptr () const { return _ptr; }
+
+	/**
+	 * @brief Hyperplane at position n along dimension d
+	 *
+	 * @param d  Dimension
+	 * @param n  Position along d
+	 */
+	NDView Slice (const size_t d, const size_t n) const {
+		assert (d < _dims.size() && n < _dims[d]);
+		if (_dims.size() == 1)
+			return NDView (_ptr + n*_strd[0], codeare::container<size_t>(1,1),
+					codeare::container<size_t>(1,1));
+		codeare::container<size_t> dims, strd;
+		for (size_t i = 0; i < _dims.size(); ++i)
+			if (i != d) {
+				dims.push_back(_dims[i]);
+				strd.push_back(_strd[i]);
+			}
+		return NDView (_ptr + n*_strd[d], dims, strd);
+	}
+
+	/**
+	 * @brief Sub-range [begin,end) along dimension d
+	 *
+	 * @param d      Dimension
+	 * @param begin  First position
+	 * @param end    Last position + 1
+	 */
+	NDView Range (const size_t d, const size_t begin, const size_t end) const {
+		assert (d < _dims.size() && begin < end && end <= _dims[d]);
+		codeare::container<size_t> dims (_dims);
+		dims[d] = end - begin;
+		return NDView (_ptr + begin*_strd[d], dims, _strd);
+	}
+
+	/**
+	 * @brief Copy viewed elements to out (sized Size())
+	 */
+	template<class S> void CopyTo (S* out) const {
+		for (size_t i = 0; i < Size(); ++i)
+			out[i] = (*this)[i];
+	}
+
+private:
+
+	T* _ptr;
+	codeare::container<size_t> _dims;
+	codeare::container<size_t> _strd;
+
+};
+
+
 /**
  * @brief  Simple nd-data structure.
  */
@@ -130,6 +264,45 @@ public:
     	Allocate();
 	}
 
+    /**
+     * @brief ND-Data with explicit allocation mode. Use ALLOC_NOINIT for
+     *        large buffers which are overwritten right away and
+     *        ALLOC_HUGEPAGE to back them by 2MB pages.
+     *
+     * @param dims  Side lengths
+     * @param mode  Allocation mode
+     */
+	explicit NDData (const codeare::container<size_t>& dims, const AllocMode mode) :
+		_data(mode) {
+		_dims = dims;
+    	Allocate();
+	}
+
+    /**
+     * @brief 1D-data with explicit allocation mode
+     *
+     * @param n0    Vector length
+     * @param mode  Allocation mode
+     */
+    explicit NDData (const size_t n0, const AllocMode mode) : _data(mode) {
+    	_dims.resize(1,n0);
+    	Allocate();
+    }
+
+    /**
+     * @brief 2D-data with explicit allocation mode
+     *
+     * @param n0    First side
+     * @param n1    Second side
+     * @param mode  Allocation mode
+     */
+    explicit NDData (const size_t n0, const size_t n1, const AllocMode mode) : _data(mode) {
+    	_dims.resize(2);
+    	_dims[0] = n0;
+    	_dims[1] = n1;
+    	Allocate();
+    }
+
     /**
      * @brief ND-Data
      *
@@ -146,10 +319,44 @@ public:
 	 *
 	 * @param data To copy
 	 */
-	NDData (const NDData& data) {
-		*this = data;
+	NDData (const NDData& data) :
+		_dims(data._dims), _dszs(data._dszs), _data(data._data) {}
+
+#if __cplusplus >= 201103L
+	/**
+	 * @brief Move constructor
+	 *
+	 * @param data To move from (left empty)
+	 */
+	NDData (NDData&& data) noexcept :
+		_dims(std::move(data._dims)), _dszs(std::move(data._dszs)),
+		_data(std::move(data._data)) {}
+
+	/**
+	 * @brief Move assignement
+	 *
+	 * @param data To move from (left empty)
+	 */
+	NDData& operator= (NDData&& data) noexcept {
+		_dims = std::move(data._dims);
+		_dszs = std::move(data._dszs);
+		_data = std::move(data._data);
+		return *this;
 	}
 
+	/**
+	 * @brief Move assignement of plain container
+	 *
+	 * @param data To move from
+	 */
+	NDData& operator= (codeare::container<T>&& data) {
+		_dims.resize(1,data.size());
+		_dszs.resize(1,1);
+		_data = std::move(data);
+		return *this;
+	}
+#endif
+
 	/**
 	 * @brief Assignement
 	 *
@@ -180,8 +387,8 @@ public:
 	inline size_t Dim (const size_t n = 0) const { return _dims[n];	}
 	inline const std::type_info& Type () { return typeid(T);}
     
-	inline const codeare::container<size_t> Dims () const { return _dims; }
-	inline const codeare::container<size_t> Dszs () const { return _dszs; }
+	inline const codeare::container<size_t>& Dims () const { return _dims; }
+	inline const codeare::container<size_t>& Dszs () const { return _dszs; }
 
 	inline size_t Size () const { return _data.size(); }
     
@@ -225,64 +432,111 @@ public:
 
 	inline T* Ptr (const size_t n = 0) { return &_data[n]; }
 
-	inline const codeare::container<T> Data () const { return _data; }
+	inline const codeare::container<T>& Data () const { return _data; }
 	inline codeare::container<T>& Data () {return _data;}
 
-	inline NDData<T> operator- () {
-		NDData<T> ret (_dims);
-		for (size_t i = 0; i < Size(); ++i)
-			ret[i] = -ret[i];
+	/**
+	 * @brief Strided view on all data (no copy)
+	 */
+	inline NDView<T> View () { return NDView<T> (_data.ptr(), _dims, _dszs); }
+	inline NDView<const T> View () const { return NDView<const T> (_data.ptr(), _dims, _dszs); }
+
+	/**
+	 * @brief Hyperplane at position n along dimension d (no copy)
+	 *
+	 * @param d  Dimension
+	 * @param n  Position along d
+	 */
+	inline NDView<T> Slice (const size_t d, const size_t n) { return View().Slice(d,n); }
+	inline NDView<const T> Slice (const size_t d, const size_t n) const { return View().Slice(d,n); }
+
+	inline NDData<T> operator- () const {
+		NDData<T> ret (*this);
+		T* d = ret.Ptr();
+		const size_t n = ret.Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] = -d[i];
 		return ret;
 	}
 
-	template<class S> inline const NDData<T>&
+	/**
+	 * @brief Fused in-place data = data * a + b (single pass, no temporary)
+	 *
+	 * @param a  Factor
+	 * @param b  Offset
+	 */
+	template<class S> inline NDData<T>&
+	MulAdd (const S a, const S b) {
+		T* d = Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] = d[i] * a + b;
+		return *this;
+	}
+
+	template<class S> inline NDData<T>&
 	operator/= (const S s) {
-		for (size_t i = 0; i < Size(); ++i)
-			_data[i] /= s;
+		T* d = Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] /= s;
 		return *this;
 	}
-	template<class S> inline const NDData<T>
-	operator/ (const S s) const {
-		NDData<T> ret (*this);
-		return ret /= s;
+	template<class S> inline friend NDData<T> // data / s, temporaries are reused
+	operator/ (NDData<T> data, const S s) {
+		data /= s;
+		return data;
 	}
-	template<class S> inline const NDData<T>&
+	template<class S> inline NDData<T>&
 	operator*= (const S s) {
-		for (size_t i = 0; i < Size(); ++i)
-			_data[i] *= s;
+		T* d = Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] *= s;
 		return *this;
 	}
-	template<class S> inline const NDData<T>
-	operator* (const S s) const {
-		NDData<T> ret (*this);
-		return ret *= s;
+	template<class S> inline friend NDData<T> // data * s
+	operator* (NDData<T> data, const S s) {
+		data *= s;
+		return data;
 	}
 
-	template<class S> inline const NDData<T>& // data += s;
+	template<class S> inline NDData<T>& // data += s;
 	operator+= (const S s) {
-		for (size_t i = 0; i < Size(); ++i)
-			_data[i] += s;
+		T* d = Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] += s;
 		return *this;
 	}
-	template<class S> inline const friend NDData<T> // data + s
-	operator+ (const S s, const NDData<T>& data) {
-		return data + s;
+	template<class S> inline friend NDData<T> // data + s
+	operator+ (NDData<T> data, const S s) {
+		data += s;
+		return data;
 	}
-	template<class S> inline const NDData<T> // s + data
-	operator+ (const S s) const {
-		NDData<T> ret (*this);
-		return ret += s;
+	template<class S> inline friend NDData<T> // s + data
+	operator+ (const S s, NDData<T> data) {
+		data += s;
+		return data;
 	}
-	template<class S> inline const NDData<T>&
-	operator^= (const S s) const {
-		for (size_t i = 0; i < Size(); ++i)
-			_data[i] ^= s;
+	template<class S> inline NDData<T>& // element-wise power
+	operator^= (const S s) {
+		T* d = Ptr();
+		const size_t n = Size();
+#pragma omp parallel for schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] = pow (d[i], s);
 		return *this;
 	}
-	template<class S> inline const NDData<T>
-	operator^ (const S s) const {
-		NDData<T> ret (*this);
-		return ret ^= s;
+	template<class S> inline friend NDData<T>
+	operator^ (NDData<T> data, const S s) {
+		data ^= s;
+		return data;
 	}
 
 
@@ -364,14 +618,18 @@ template <class T> inline static NDData<T>
 imag (const NDData<std::complex<T> >& data) {
 	NDData<T> ret (data.Dims());
 	for (size_t i = 0; i < ret.Size(); ++i)
-		ret[i] = real(data[i]);
+		ret[i] = imag(data[i]);
 	return ret;
 }
 template <class T> inline static NDData<T>
 abs (const NDData<std::complex<T> >& data) {
-	NDData<T> ret (data.Dims());
-	for (size_t i = 0; i < ret.Size(); ++i)
-		ret[i] = abs(data[i]);
+	NDData<T> ret (data.Dims(), ALLOC_NOINIT);
+	const std::complex<T>* d = data.Ptr();
+	T* r = ret.Ptr();
+	const size_t n = ret.Size();
+#pragma omp parallel for schedule(static) if (n > PAR_THRESHOLD)
+	for (size_t i = 0; i < n; ++i)
+		r[i] = std::abs(d[i]);
 	return ret;
 }
 template <class T> inline static NDData<T>
@@ -403,18 +661,20 @@ complex2 (const NDData<T>& amp, const NDData<T>& pha) {
 template<class T> inline static T
 max (const NDData<T>& data) {
 	assert (!data.Empty());
-	T ret = data[0];
-	for (size_t i = 0; i < data.Size(); ++i)
-		ret = (ret < data[i]) ? data[i] : ret;
-	return ret;
+	return minmax (data.Data()).max;
 }
 template<class T> inline static T
 min (const NDData<T>& data) {
 	assert (!data.Empty());
-	T ret = data[0];
-	for (size_t i = 0; i < data.Size(); ++i)
-		ret = (ret > data[i]) ? data[i] : ret;
-	return ret;
+	return minmax (data.Data()).min;
+}
+
+/**
+ * @brief Compensated sum over all elements, reproducible for any thread count
+ */
+template<class T> inline static T
+sum (const NDData<T>& data) {
+	return sum (data.Data());
 }
 
 template<class T> inline static bool
@@ -10,13 +10,19 @@
 
 #include "Event.hpp"
 
+#include <boost/array.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <complex>
 #include <vector>
 
 template<class T> class HardRF;
 template<class T> class AdiabaticRF;
+template<class T> class SampledRF;
+template<class T> class RepeatRF;
 
-enum RFType {NONE_RF = -1, HARD_RF, ADIABATIC_RF, SINC_RF};
+enum RFType {NONE_RF = -1, HARD_RF, ADIABATIC_RF, SINC_RF, SAMPLED_RF, REPEAT_RF};
 
 template<class T> class RF : public Event<T> {
 
@@ -35,33 +41,169 @@ public:
 		switch (this->Type()) {
 			case ADIABATIC_RF: return (*(const AdiabaticRF<T>*)this)(t);
 			case HARD_RF:	   return (*(const HardRF<T>*)this)(t);
+			case SAMPLED_RF:   return (*(const SampledRF<T>*)this)(t);
+			case REPEAT_RF:    return (*(const RepeatRF<T>*)this)(t);
 			default:           return std::complex<T>(0.,0.);
 		}
 	}
 
+	/**
+	 * @brief Time derivative d/dt of the RF at t (Jacobian of implicit steppers)
+	 */
+	std::complex<T> Derivative (double t) const {
+		switch (this->Type()) {
+			case ADIABATIC_RF: return ((const AdiabaticRF<T>*)this)->Derivative(t);
+			case HARD_RF:	   return ((const HardRF<T>*)this)->Derivative(t);
+			case SAMPLED_RF:   return ((const SampledRF<T>*)this)->Derivative(t);
+			case REPEAT_RF:    return ((const RepeatRF<T>*)this)->Derivative(t);
+			default:           return std::complex<T>(0.,0.);
+		}
+	}
+
+	/**
+	 * @brief Evaluate at n times t into out (e.g. an aligned NDData<CT>
+	 *        buffer). One type switch per batch, vectorisable loops within.
+	 *
+	 * @param t    Times
+	 * @param n    Number of times
+	 * @param out  RF at times (n)
+	 */
+	void Evaluate (const double* t, const size_t n, std::complex<T>* out) const {
+		switch (this->Type()) {
+			case ADIABATIC_RF: ((const AdiabaticRF<T>*)this)->Evaluate(t, n, out); break;
+			case HARD_RF:	   ((const HardRF<T>*)this)->Evaluate(t, n, out); break;
+			case SAMPLED_RF:   ((const SampledRF<T>*)this)->Evaluate(t, n, out); break;
+			case REPEAT_RF:    ((const RepeatRF<T>*)this)->Evaluate(t, n, out); break;
+			default:           std::fill (out, out+n, std::complex<T>(0.,0.)); break;
+		}
+	}
+
+	/**
+	 * @brief Evaluate at times t
+	 */
+	NDData<CT> Evaluate (const NDData<double>& t) const {
+		NDData<CT> ret (t.Size(), ALLOC_NOINIT);
+		Evaluate (t.Ptr(), t.Size(), ret.Ptr());
+		return ret;
+	}
+
 	inline RFType Type () const {
 		return _type;
 	}
 
+	/**
+	 * @brief Hash of type, times and parameters (incremental re-simulation:
+	 *        equal pulses, equal hashes)
+	 */
+	uint64_t Hash () const {
+		uint64_t h = Event<T>::Hash();
+		h = fnv1a (&_type, sizeof(_type), h);
+		h = fnv1a (&_scale, sizeof(_scale), h);
+		if (_type == SAMPLED_RF)
+			h = ((const SampledRF<T>*)this)->HashSamples (h);
+		else if (_type == REPEAT_RF)
+			h = ((const RepeatRF<T>*)this)->HashBlock (h);
+		return h;
+	}
+
+	/**
+	 * @brief n_samples equidistant samples from start (times, values).
+	 *        Multithreaded for large n_samples.
+	 */
 	boost::tuple<NDData<double>, NDData<CT> >Dump (size_t n_samples) const {
 		assert (n_samples > 0);
-		NDData<double> times (n_samples);
-		NDData<CT> data (n_samples);
-		double dt = this->Duration()/n_samples;
-		for (size_t i = 0; i < n_samples; ++i) {
-			double t = dt * i;
-			times[i] = t;
-			data[i] = (*this)(t);
+		boost::tuple<NDData<double>, NDData<CT> > ret; // Filled in place
+		NDData<double>& times = boost::get<0>(ret) = NDData<double> (n_samples, ALLOC_NOINIT);
+		NDData<CT>&     data  = boost::get<1>(ret) = NDData<CT> (n_samples, ALLOC_NOINIT);
+		DumpRange (0, n_samples, n_samples, times.Ptr(), data.Ptr());
+		return ret;
+	}
+
+	/**
+	 * @brief As Dump(n_samples), streamed to chunked data sets "times" and
+	 *        "data" in group url of an open file, chunk samples at a time.
+	 *        Same file layout as writing Dump()'s result, memory bounded by
+	 *        the chunk.
+	 *
+	 * @param f          Open file
+	 * @param n_samples  Number of samples
+	 * @param url        Group
+	 * @param chunk      Samples per chunk (HDF5 chunk and write size)
+	 * @return           Status
+	 */
+	IOStatus Dump (HDF5File& f, const size_t n_samples, const std::string& url = "/",
+			const size_t chunk = 1 << 20) const {
+		assert (n_samples > 0 && chunk > 0);
+		const size_t n = std::min (chunk, n_samples);
+		IOStatus s;
+		if ((s = f.Create<double> ("times", n_samples, url, n)) != OK ||
+			(s = f.Create<CT> ("data", n_samples, url, n)) != OK)
+			return s;
+		NDData<double> times (n, ALLOC_NOINIT);
+		NDData<CT>     data  (n, ALLOC_NOINIT);
+		for (size_t i0 = 0; i0 < n_samples; i0 += n) {
+			const size_t m = std::min (n, n_samples - i0);
+			DumpRange (i0, m, n_samples, times.Ptr(), data.Ptr());
+			if ((s = f.WritePart (times.Ptr(), i0, m, "times", url)) != OK ||
+				(s = f.WritePart (data.Ptr(), i0, m, "data", url)) != OK)
+				return s;
 		}
-		return boost::make_tuple(times, data);
+		return OK;
 	}
 
 
 protected:
+
+	/**
+	 * @brief Samples [i0, i0+n) of n_samples over the duration, blocks of
+	 *        samples distributed over threads
+	 */
+	void DumpRange (const size_t i0, const size_t n, const size_t n_samples,
+			double* times, CT* data) const {
+		const size_t block = 4096;
+		const double t0 = this->_tpois.front(), dt = this->Duration()/n_samples;
+		const long nb = (n + block - 1) / block;
+#pragma omp parallel for schedule(static) if (n > PAR_THRESHOLD)
+		for (long b = 0; b < nb; ++b) {
+			const size_t j0 = b * block, m = std::min (block, n - j0);
+			for (size_t j = j0; j < j0 + m; ++j)
+				times[j] = t0 + dt * (i0 + j);
+			Evaluate (times + j0, m, data + j0);
+		}
+	}
+
 	T _phase_offset;
 	std::complex<T> _scale;
 	RFType _type;
 
 };
 
+/**
+ * @brief Propagator exp(B dt) of the Bloch equations without relaxation in
+ *        a constant field (bx, by, bz) [rad/s]: dm/dt = -b x m turns m about
+ *        -b by |b| dt (Rodrigues).
+ *
+ * @param bx  Field x
+ * @param by  Field y
+ * @param bz  Field z (off-resonance)
+ * @param dt  Duration
+ * @param R   Rotation (3x3, column major as the Bloch matrix)
+ */
+template<class T> inline void
+rotation_matrix (const double bx, const double by, const double bz, const double dt,
+		boost::array<T,9>& R) {
+
+	const double b = std::sqrt (bx*bx + by*by + bz*bz), theta = b*dt;
+	double n[3] = { 0., 0., 0. };
+	if (b > 0.) {
+		n[0] = -bx/b; n[1] = -by/b; n[2] = -bz/b;
+	}
+	const double c = std::cos(theta), s = std::sin(theta), C = 1.-c;
+
+	R[0] = c + C*n[0]*n[0];      R[3] = C*n[0]*n[1] - s*n[2]; R[6] = C*n[0]*n[2] + s*n[1];
+	R[1] = C*n[1]*n[0] + s*n[2]; R[4] = c + C*n[1]*n[1];      R[7] = C*n[1]*n[2] - s*n[0];
+	R[2] = C*n[2]*n[0] - s*n[1]; R[5] = C*n[2]*n[1] + s*n[0]; R[8] = c + C*n[2]*n[2];
+
+}
+
 #endif /* RF_H_ */
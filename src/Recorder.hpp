@@ -18,42 +18,88 @@ enum RMedium {STDOUT, SAVE};
 template<RMedium R> class Recorder {
 
 public:
-	Recorder () {}; // If file open
+	Recorder (const std::string& fname = "simout.h5") :
+		_fname(fname), _times(ALLOC_ARENA), _states(ALLOC_ARENA) {}; // Growth in run's arena
 	virtual ~Recorder () {}; // If file close
 	void operator () (const state_type& m, double t);
 
+	inline size_t Size () const { return _times.size(); }
+
+	/**
+	 * @brief Write recorded times and states to group url of an open file
+	 *
+	 * @return  Status of the first failed write (OK if none)
+	 */
+	IOStatus Write (HDF5File& f, const std::string& url = "/") const;
+
+	/**
+	 * @brief Recorded times (n) and states (n x 3), as written by Write()
+	 */
+	void Get (NDData<double>& times, NDData<double>& data) const;
+
+	/**
+	 * @brief Replace recorded times and states (from Get(), e.g. a checkpoint)
+	 */
+	void Assign (const NDData<double>& times, const NDData<double>& data);
+
 protected:
+	std::string _fname;
 	codeare::container<double> _times;
 	codeare::container<state_type> _states;
 
 };
 
 template<> inline void Recorder<STDOUT>::operator() (const state_type& m, double t) {
+	STATS_INC(RECORDER_CALLS);
 	std::cout << std::setprecision(6) << std::fixed << std::setw(16) << t
 	         << std::scientific << std::setw(16) << m[0] <<
 	         std::setw(16) << m[1] << std::setw(16) << m[2] << std::endl;
 }
 
 template<> inline void Recorder<SAVE>::operator() (const state_type& m, double t) {
+	STATS_INC(RECORDER_CALLS);
 	_states.push_back(m);
 	_times.push_back(t);
 }
 
-template<> Recorder<SAVE>::~Recorder () {
+template<> inline void Recorder<SAVE>::Get (NDData<double>& times, NDData<double>& data) const {
 	size_t n_samples = _states.size();
-	if (n_samples == 0)
-		return;
-	HDF5File f ("simout.h5", OUT);
-	NDData<double> times (n_samples);
-	NDData<double> data (n_samples,3);
+	times = NDData<double> (n_samples, ALLOC_NOINIT);
+	data  = NDData<double> (n_samples, 3, ALLOC_NOINIT);
 	for (size_t i = 0; i < n_samples; ++i) {
 		times [i] = _times[i];
 		data (i,0) = _states[i][0];
 		data (i,1) = _states[i][1];
 		data (i,2) = _states[i][2];
 	}
-	f.Write (times, "times");
-	f.Write (data, "data");
+}
+
+template<> inline void Recorder<SAVE>::Assign (const NDData<double>& times, const NDData<double>& data) {
+	_times.data().clear();
+	_states.data().clear();
+	for (size_t i = 0; i < times.Size(); ++i) {
+		state_type m = {{data(i,0), data(i,1), data(i,2)}};
+		_states.push_back(m);
+		_times.push_back(times[i]);
+	}
+}
+
+template<> inline IOStatus Recorder<SAVE>::Write (HDF5File& f, const std::string& url) const {
+	NDData<double> times, data;
+	Get (times, data);
+	IOStatus s = f.Write (times, "times", url);
+	return (s != OK) ? s : f.Write (data, "data", url);
+}
+
+template<> Recorder<SAVE>::~Recorder () {
+	if (_states.empty() || _fname.empty()) // Empty file name: memory only
+		return;
+	HDF5File f (_fname, OUT);
+	Write (f);
+#ifdef WITH_STATS
+	if (Stats::On())
+		Stats::Instance().Write (f);
+#endif
 	fclose (f);
 }
 
@@ -0,0 +1,201 @@
+/*
+ * RepeatRF.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef REPEATRF_HPP_
+#define REPEATRF_HPP_
+
+#include "RF.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+/**
+ * @brief Repeat block: a group of pulses (times relative to the start of a
+ *        repetition, within the period) played count times every period
+ *        from start. Evaluated lazily, repetition and time within it by
+ *        modular arithmetic: memory and lookup cost do not grow with the
+ *        count or the repetitions passed. Repetition k is
+ *        [start + k period, start + (k+1) period).
+ *
+ *        Per repetition tables, cycled if shorter than the count (phase
+ *        cycling), scale the group:
+ *
+ *        - Scales: amplitude (variable flip angles), empty: 1
+ *        - Phases: phase [rad] (phase cycling, RF spoiling), empty: 0
+ *
+ *        The group is held by pointer, as by Bloch::AddEvent(). Start()
+ *        and HashRepetition() describe single repetitions, e.g. for the
+ *        per repetition boundaries of Incremental.
+ */
+template<class T>
+class RepeatRF : public RF<T> {
+
+	typedef std::complex<T> CT;
+
+public:
+
+	RepeatRF () : RF<T> (), _period(0.), _count(0) {
+		this->_type = REPEAT_RF;
+	}
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param start   Start of the first repetition
+	 * @param period  Period
+	 * @param count   Number of repetitions
+	 * @param scale   Scale of the whole block
+	 */
+	RepeatRF (const double start, const double period, const size_t count,
+			const CT scale = 1.) :
+		RF<T> (start, start + count * period, scale), _period(period), _count(count) {
+		assert (period > 0.);
+		this->_type = REPEAT_RF;
+	}
+
+	virtual ~RepeatRF() {};
+
+	/**
+	 * @brief Add a pulse to the group
+	 *
+	 * @param rf  Pulse, times within [0, period]
+	 */
+	inline void Add (const RF<T>& rf) {
+		assert (rf.Type() != REPEAT_RF);
+		_group.push_back (&rf);
+	}
+
+	inline const std::vector<const RF<T>*>& Group () const { return _group; }
+
+	/**
+	 * @brief Per repetition amplitudes, cycled
+	 */
+	inline void Scales (const std::vector<T>& scales) { _scales = scales; }
+
+	/**
+	 * @brief Per repetition phases [rad], cycled
+	 */
+	inline void Phases (const std::vector<T>& phases) { _phases = phases; }
+
+	inline const std::vector<T>& Scales () const { return _scales; }
+
+	inline const std::vector<T>& Phases () const { return _phases; }
+
+	/**
+	 * @brief RF spoiling phases of n repetitions: phi0 k(k+1)/2 (mod 2 pi)
+	 *
+	 * @param n     Number of repetitions
+	 * @param phi0  Phase increment [rad]
+	 * @return      Phases
+	 */
+	static std::vector<T> QuadraticPhases (const size_t n, const double phi0) {
+		std::vector<T> ret (n);
+		for (size_t k = 0; k < n; ++k)
+			ret[k] = std::fmod (.5*phi0*k*(k+1), TWOPI);
+		return ret;
+	}
+
+	inline double Period () const { return _period; }
+
+	inline size_t Count () const { return _count; }
+
+	/**
+	 * @brief Start of repetition k (k = count: end of the block)
+	 */
+	inline double Start (const size_t k) const { return this->_tpois.front() + k * _period; }
+
+	CT operator() (double t) const {
+		if (!this->Active(t) || _count == 0)
+			return CT(0., 0.);
+		size_t k;
+		const double tau = Locate (t, k);
+		CT sum (0., 0.);
+		for (size_t i = 0; i < _group.size(); ++i)
+			sum += (*_group[i])(tau);
+		return (sum == CT(0., 0.)) ? sum : Factor(k) * sum;
+	}
+
+	void Evaluate (const double* t, const size_t n, CT* out) const {
+		for (size_t i = 0; i < n; ++i)
+			out[i] = (*this)(t[i]);
+	}
+
+	CT Derivative (double t) const {
+		if (!this->Active(t) || _count == 0)
+			return CT(0., 0.);
+		size_t k;
+		const double tau = Locate (t, k);
+		CT sum (0., 0.);
+		for (size_t i = 0; i < _group.size(); ++i)
+			sum += _group[i]->Derivative(tau);
+		return (sum == CT(0., 0.)) ? sum : Factor(k) * sum;
+	}
+
+	/**
+	 * @brief Continue hash h with period, count, tables and group (see
+	 *        RF::Hash())
+	 */
+	uint64_t HashBlock (uint64_t h) const {
+		h = fnv1a (&_period, sizeof(_period), h);
+		h = fnv1a (&_count, sizeof(_count), h);
+		if (!_scales.empty())
+			h = fnv1a (&_scales[0], _scales.size()*sizeof(T), h);
+		if (!_phases.empty())
+			h = fnv1a (&_phases[0], _phases.size()*sizeof(T), h);
+		for (size_t i = 0; i < _group.size(); ++i) {
+			const uint64_t g = _group[i]->Hash();
+			h = fnv1a (&g, sizeof(g), h);
+		}
+		return h;
+	}
+
+	/**
+	 * @brief Hash of repetition k: its factor (block scale and table
+	 *        entries), period and group. Equal for repetitions played alike.
+	 */
+	uint64_t HashRepetition (const size_t k) const {
+		const CT f = Factor (k);
+		uint64_t h = fnv1a (&f, sizeof(f));
+		h = fnv1a (&_period, sizeof(_period), h);
+		for (size_t i = 0; i < _group.size(); ++i) {
+			const uint64_t g = _group[i]->Hash();
+			h = fnv1a (&g, sizeof(g), h);
+		}
+		return h;
+	}
+
+private:
+
+	/** Repetition k of t and time within **/
+	inline double Locate (const double t, size_t& k) const {
+		const double u = t - this->_tpois.front();
+		k = std::min ((size_t) (u / _period), _count - 1);
+		return u - k * _period;
+	}
+
+	/** Block scale times table entries of repetition k **/
+	inline CT Factor (const size_t k) const {
+		CT f = this->_scale;
+		if (!_scales.empty())
+			f *= _scales[k % _scales.size()];
+		if (!_phases.empty())
+			f *= std::polar ((T)1., _phases[k % _phases.size()]);
+		return f;
+	}
+
+	double _period;
+	size_t _count;
+	std::vector<const RF<T>*> _group;
+	std::vector<T> _scales;
+	std::vector<T> _phases;
+
+};
+
+#endif /* REPEATRF_HPP_ */
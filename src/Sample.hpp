@@ -11,28 +11,58 @@
 #include "Spin.hpp"
 
 #include <vector>
+#include <assert.h>
 
 template<class T> class Sample {
 
 public:
 
-	Sample();
-
-	Sample(size_t n);
+	Sample() {};
+
+	/**
+	 * @brief n copies of a spin
+	 *
+	 * @param n     Number of spins
+	 * @param spin  Spin
+	 */
+	Sample(size_t n, const Spin<T>& spin = Spin<T>()) {
+		_stack.reserve(n);
+		_untouched.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			PushBack(spin);
+	}
 
-	virtual ~Sample();
+	virtual ~Sample() {};
 
 	inline void PushBack (const Spin<T>& spin) {
 		_stack.push_back(spin);
 		_untouched.push_back(_stack.size()-1);
 	}
 
-	inline std::vector<Spin<T> > Spins () const {
+	inline const std::vector<Spin<T> >& Spins () const {
 		return _stack;
 	}
 
-	inline Spin& GetNext () {
-		size_t n = _untouched.back();
+	inline size_t Size () const {
+		return _stack.size();
+	}
+
+	inline const Spin<T>& operator[] (const size_t n) const {
+		return _stack[n];
+	}
+
+	inline bool Done () const {
+		return _untouched.empty();
+	}
+
+	/**
+	 * @brief Next unprocessed spin
+	 *
+	 * @param n  Its index (for TurnIn)
+	 */
+	inline const Spin<T>& GetNext (size_t& n) {
+		assert (!_untouched.empty());
+		n = _untouched.back();
 		_untouched.pop_back();
 		return _stack[n];
 	}
@@ -42,6 +72,41 @@ public:
 		_done.push_back(n);
 	}
 
+	/**
+	 * @brief Processed spins (in order of TurnIn)
+	 */
+	inline const std::vector<size_t>& Processed () const {
+		return _done;
+	}
+
+	/**
+	 * @brief Spins not handed out yet
+	 */
+	inline const std::vector<size_t>& Untouched () const {
+		return _untouched;
+	}
+
+	/**
+	 * @brief Mark untouched spins processed (restart from a checkpoint)
+	 *
+	 * @param done  Their indices
+	 */
+	inline void Resume (const std::vector<size_t>& done) {
+		std::vector<bool> mark (_stack.size(), false);
+		for (size_t i = 0; i < done.size(); ++i) {
+			assert (done[i] < _stack.size());
+			mark[done[i]] = true;
+		}
+		std::vector<size_t> untouched;
+		untouched.reserve (_untouched.size());
+		for (size_t i = 0; i < _untouched.size(); ++i)
+			if (mark[_untouched[i]])
+				_done.push_back (_untouched[i]);
+			else
+				untouched.push_back (_untouched[i]);
+		_untouched.swap (untouched);
+	}
+
 	inline void RandomOrder () {
 
 	}
@@ -0,0 +1,354 @@
+/*
+ * SampledRF.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SAMPLEDRF_HPP_
+#define SAMPLEDRF_HPP_
+
+#include "RF.hpp"
+#include "Spin.hpp"
+
+#include <boost/array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include <cmath>
+#include <complex>
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#    include <mutex>
+#endif
+
+/**
+ * @brief Arbitrary waveform: complex samples, piecewise constant over one
+ *        dwell time each (sample i on [start + i dwell, start + (i+1) dwell)),
+ *        e.g. scanner pulses from file or RF::Dump() of another pulse.
+ *
+ *        Besides the Bloch<T> ODE path, a pulse can be applied to spins
+ *        directly: within a sample the field is constant, so the exact
+ *        propagator (without relaxation) is a rotation. The rotations of
+ *        all samples are computed once per B1 scale and off-resonance and
+ *        cached (the most recent CacheCapacity() sets); applying the pulse
+ *        is then one 3x3 matrix-vector product per sample.
+ */
+template<class T>
+class SampledRF : public RF<T> {
+
+	typedef std::complex<T> CT;
+
+public:
+
+	typedef boost::array<T,9> rotation_type;
+	typedef std::vector<rotation_type> rotations_type;
+	typedef boost::shared_ptr<const rotations_type> rotations_ptr;
+
+	static const size_t CACHE_CAPACITY = 64; /**< @brief Default rotation sets cached */
+
+	SampledRF () : RF<T> (), _dwell(0.), _capacity(CACHE_CAPACITY) {
+		this->_type = SAMPLED_RF;
+	}
+
+	/**
+	 * @brief Construct from samples
+	 *
+	 * @param start    Start time
+	 * @param dwell    Dwell time per sample
+	 * @param samples  Samples [T]
+	 * @param scale    Scale
+	 */
+	SampledRF (const double start, const double dwell, const NDData<CT>& samples,
+			const CT scale = 1.) : RF<T> (start, start, scale), _dwell(0.), _capacity(CACHE_CAPACITY) {
+		this->_type = SAMPLED_RF;
+		Set (start, dwell, samples);
+	}
+
+	/**
+	 * @brief Construct from RF::Dump() (times, samples) of another pulse
+	 *
+	 * @param dump   Sample times (equidistant) and samples
+	 * @param scale  Scale
+	 */
+	SampledRF (const boost::tuple<NDData<double>, NDData<CT> >& dump, const CT scale = 1.) :
+		RF<T> (0., 0., scale), _dwell(0.), _capacity(CACHE_CAPACITY) {
+		this->_type = SAMPLED_RF;
+		Set (boost::get<0>(dump), boost::get<1>(dump));
+	}
+
+	/**
+	 * @brief Copy waveform and cache capacity, not the cache
+	 */
+	SampledRF (const SampledRF& r) :
+		RF<T> (r), _dwell(r._dwell), _samples(r._samples), _capacity(r._capacity) {}
+
+	SampledRF& operator= (const SampledRF& r) {
+		if (this != &r) {
+			RF<T>::operator= (r);
+			_dwell    = r._dwell;
+			_samples  = r._samples;
+			_capacity = r._capacity;
+			ClearCache();
+		}
+		return *this;
+	}
+
+	virtual ~SampledRF() {};
+
+	/**
+	 * @brief Load "times" and "data" (as written by the RF dump of
+	 *        odeint_bloch) from group url
+	 *
+	 * @param f    Open file
+	 * @param url  Group
+	 * @return     Success
+	 */
+	bool Read (HDF5File& f, const std::string& url = "/") {
+		NDData<double> times;
+		NDData<CT> samples;
+		if (f.Read (times, "times", url) != codeare::io::OK ||
+			f.Read (samples, "data", url) != codeare::io::OK) {
+			std::cerr << "Cannot read sampled RF times/data from " << url << std::endl;
+			return false;
+		}
+		return Set (times, samples);
+	}
+
+	CT operator() (double t) const {
+		if (!this->Active(t) || _samples.empty())
+			return CT(0., 0.);
+		size_t i = (size_t) ((t - this->_tpois.front()) / _dwell);
+		return this->_scale * _samples[std::min(i, _samples.size()-1)];
+	}
+
+	void Evaluate (const double* t, const size_t n, CT* out) const {
+		for (size_t i = 0; i < n; ++i)
+			out[i] = (*this)(t[i]);
+	}
+
+	CT Derivative (double) const {
+		return CT(0., 0.); // Constant within samples
+	}
+
+	inline size_t Size () const { return _samples.size(); }
+
+	inline double Dwell () const { return _dwell; }
+
+	/**
+	 * @brief Continue hash h with dwell time and samples (see RF::Hash())
+	 */
+	uint64_t HashSamples (uint64_t h) const {
+		h = fnv1a (&_dwell, sizeof(_dwell), h);
+		return _samples.empty() ? h : fnv1a (&_samples[0], _samples.size()*sizeof(CT), h);
+	}
+
+	/**
+	 * @brief Per sample rotations for a B1 scale and off-resonance, computed
+	 *        on first use and kept in a cache of the most recently used
+	 *        CacheCapacity() sets (thread safe: std::thread and OpenMP
+	 *        callers under C++11, OpenMP only before). Rotations are
+	 *        computed outside the lock; the caller shares ownership, so
+	 *        eviction does not pull them away.
+	 *
+	 * @param b1      B1 scale (e.g. from a B1 map)
+	 * @param offres  Off-resonance [rad/s]
+	 * @return        Rotations, one per sample
+	 */
+	rotations_ptr Rotations (const T b1 = 1., const T offres = 0.) const {
+		const key_type key (b1, offres);
+		rotations_ptr ret;
+#if __cplusplus >= 201103L
+		{
+			std::lock_guard<std::mutex> lock (_mutex);
+			ret = Lookup (key);
+		}
+		if (!ret) {
+			const rotations_ptr r = Compute (b1, offres);
+			std::lock_guard<std::mutex> lock (_mutex);
+			ret = Insert (key, r); // Another thread's if it came first
+		}
+#else
+#pragma omp critical (sampled_rf)
+		{
+			ret = Lookup (key);
+			if (!ret)
+				ret = Insert (key, Compute (b1, offres));
+		}
+#endif
+		return ret;
+	}
+
+	inline size_t CacheSize () const { return _cache.size(); }
+
+	inline size_t CacheCapacity () const { return _capacity; }
+
+	/**
+	 * @brief Rotation sets kept at most (at least 1), least recently used
+	 *        evicted first. Not thread safe.
+	 */
+	inline void CacheCapacity (const size_t n) {
+		_capacity = std::max (n, (size_t) 1);
+		while (_cache.size() > _capacity)
+			Evict();
+	}
+
+	/** Not thread safe **/
+	inline void ClearCache () {
+		_cache.clear();
+		_lru.clear();
+	}
+
+	/**
+	 * @brief Apply the whole pulse to m, relaxation neglected
+	 *
+	 * @param m       Magnetisation (state_type or any indexable 3-vector)
+	 * @param b1      B1 scale
+	 * @param offres  Off-resonance [rad/s]
+	 */
+	template<class State> void
+	Apply (State& m, const T b1 = 1., const T offres = 0.) const {
+		const rotations_ptr r = Rotations (b1, offres);
+		const rotations_type& R = *r;
+		for (size_t i = 0; i < R.size(); ++i)
+			Rotate (R[i], m);
+	}
+
+	/**
+	 * @brief Apply the whole pulse to a batch of spins sharing B1 scale and
+	 *        off-resonance, relaxation neglected. Spin outer, samples inner:
+	 *        m stays in registers, the rotation table in cache.
+	 *
+	 * @param m       Magnetisations
+	 * @param b1      B1 scale
+	 * @param offres  Off-resonance [rad/s]
+	 */
+	template<class State> void
+	Apply (std::vector<State>& m, const T b1 = 1., const T offres = 0.) const {
+		const rotations_ptr r = Rotations (b1, offres);
+		const rotations_type& R = *r;
+		const long n = m.size();
+#pragma omp parallel for schedule(static) if (n > PAR_THRESHOLD)
+		for (long j = 0; j < n; ++j)
+			for (size_t i = 0; i < R.size(); ++i)
+				Rotate (R[i], m[j]);
+	}
+
+	/**
+	 * @brief Apply the whole pulse to a spin: rotation at its off-resonance,
+	 *        then T1/T2 relaxation, per sample (first order splitting)
+	 *
+	 * @param spin  Spin
+	 * @param m     Magnetisation
+	 * @param b1    B1 scale
+	 */
+	template<class State> void
+	Apply (const Spin<T>& spin, State& m, const T b1 = 1.) const {
+		const rotations_ptr r = Rotations (b1, spin.cs());
+		const rotations_type& R = *r;
+		const T e1 = std::exp(-_dwell/spin.t1()), e2 = std::exp(-_dwell/spin.t2()),
+				recovery = spin.pd() * (1. - e1);
+		for (size_t i = 0; i < R.size(); ++i) {
+			Rotate (R[i], m);
+			m[0] *= e2;
+			m[1] *= e2;
+			m[2]  = e1*m[2] + recovery;
+		}
+	}
+
+private:
+
+	typedef std::pair<T,T> key_type;
+	typedef std::list<key_type> lru_type; // Most recent first
+
+	struct CacheEntry {
+		rotations_ptr rotations;
+		typename lru_type::iterator lru;
+	};
+
+	typedef std::map<key_type, CacheEntry> cache_type;
+
+	rotations_ptr Compute (const T b1, const T offres) const {
+		rotations_type* r = new rotations_type (_samples.size());
+		for (size_t i = 0; i < _samples.size(); ++i) {
+			const CT b = b1 * this->_scale * _samples[i];
+			rotation_matrix (GAMMA*real(b), GAMMA*imag(b), offres, _dwell, (*r)[i]);
+		}
+		return rotations_ptr (r);
+	}
+
+	/** Cached rotations (null if missing), marked most recent; caller locks **/
+	rotations_ptr Lookup (const key_type& key) const {
+		typename cache_type::iterator it = _cache.find (key);
+		if (it == _cache.end())
+			return rotations_ptr();
+		_lru.splice (_lru.begin(), _lru, it->second.lru);
+		return it->second.rotations;
+	}
+
+	/** Cache r unless key is cached, evict beyond capacity; caller locks **/
+	rotations_ptr Insert (const key_type& key, const rotations_ptr& r) const {
+		const rotations_ptr cached = Lookup (key);
+		if (cached)
+			return cached;
+		_lru.push_front (key);
+		CacheEntry& e = _cache[key];
+		e.rotations = r;
+		e.lru = _lru.begin();
+		while (_cache.size() > _capacity)
+			Evict();
+		return r;
+	}
+
+	void Evict () const {
+		_cache.erase (_lru.back());
+		_lru.pop_back();
+	}
+
+	bool Set (const double start, const double dwell, const NDData<CT>& samples) {
+		if (dwell <= 0. || samples.Size() == 0) {
+			std::cerr << "Sampled RF needs samples and a positive dwell time" << std::endl;
+			return false;
+		}
+		_dwell = dwell;
+		_samples.assign (samples.Ptr(), samples.Ptr() + samples.Size());
+		this->_tpois.front() = start;
+		this->_tpois.back()  = start + dwell * _samples.size();
+		ClearCache();
+		return true;
+	}
+
+	bool Set (const NDData<double>& times, const NDData<CT>& samples) {
+		if (times.Size() < 2 || times.Size() != samples.Size()) {
+			std::cerr << "Sampled RF needs as many (at least 2) times as samples" << std::endl;
+			return false;
+		}
+		return Set (times[0], times[1] - times[0], samples);
+	}
+
+	template<class State> inline static void
+	Rotate (const rotation_type& R, State& m) {
+		const T x = m[0], y = m[1], z = m[2];
+		m[0] = R[0]*x + R[3]*y + R[6]*z;
+		m[1] = R[1]*x + R[4]*y + R[7]*z;
+		m[2] = R[2]*x + R[5]*y + R[8]*z;
+	}
+
+	double _dwell;
+	std::vector<CT> _samples;
+	size_t _capacity;
+	mutable cache_type _cache;
+	mutable lru_type _lru;
+#if __cplusplus >= 201103L
+	mutable std::mutex _mutex; // Of this pulse's cache
+#endif
+
+};
+
+#endif /* SAMPLEDRF_HPP_ */
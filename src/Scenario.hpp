@@ -0,0 +1,665 @@
+/*
+ * Scenario.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SCENARIO_HPP_
+#define SCENARIO_HPP_
+
+#include "Bloch.hpp"
+#include "Distributed.hpp"
+#include "EPG.hpp"
+#include "Incremental.hpp"
+#include "Recorder.hpp"
+#include "Sample.hpp"
+#include "Simulation.hpp"
+#include "Stepper.hpp"
+#include "Voxel.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief RF event description, key of the RF cache
+ */
+struct RFSpec {
+
+	RFSpec () : type(NONE_RF), start(0.), end(0.), scale(0.,0.) {}
+
+	/**
+	 * @brief Parse "hard start end re im" or "adiabatic start end scale"
+	 */
+	bool Parse (const std::string& s) {
+		std::istringstream iss (s);
+		std::string name;
+		double re = 0., im = 0.;
+		iss >> name >> start >> end >> re;
+		if (name == "hard") {
+			iss >> im;
+			type = HARD_RF;
+		} else if (name == "adiabatic") {
+			type = ADIABATIC_RF;
+		} else {
+			return false;
+		}
+		scale = std::complex<double>(re, im);
+		return !iss.fail() && end >= start;
+	}
+
+	inline bool operator< (const RFSpec& r) const {
+		if (type  != r.type)         return type  < r.type;
+		if (start != r.start)        return start < r.start;
+		if (end   != r.end)          return end   < r.end;
+		if (real(scale) != real(r.scale)) return real(scale) < real(r.scale);
+		return imag(scale) < imag(r.scale);
+	}
+
+	RFType type;
+	double start, end;
+	std::complex<double> scale;
+
+};
+
+
+/**
+ * @brief Repeat block description (see RepeatRF)
+ */
+template<class T> struct RepeatSpec {
+
+	RepeatSpec () : start(0.), period(0.), count(0) {}
+
+	double start, period;
+	size_t count;
+	std::vector<RFSpec> rfs; /**< @brief Group, times within the period */
+	std::vector<T> scales;   /**< @brief Per repetition amplitudes */
+	std::vector<T> phases;   /**< @brief Per repetition phases [rad] */
+
+};
+
+
+/**
+ * @brief What a scenario records
+ */
+enum RecordMode {
+	RECORD_FINAL,      /**< @brief Final magnetisation of all spins (3 x n) */
+	RECORD_SIGNAL,     /**< @brief Final magnetisation summed over spins (3 x 1) */
+	RECORD_TRAJECTORY  /**< @brief Every step of a single spin */
+};
+
+/**
+ * @brief Solver of a scenario
+ */
+enum Solver {
+	ODE_SOLVER, /**< @brief Bloch equations per spin (isochromat) */
+	EPG_SOLVER  /**< @brief Extended phase graph per spin (voxel), see EPG */
+};
+
+/**
+ * @brief One simulation: sample, events, initial state, time span, stepper
+ *        and output. Read from scenario files:
+ *
+ *        # comment
+ *        [name]                           starts a scenario (HDF5 group /name)
+ *        spin    = pd t1 t2 [cs]          one spin, cs off-resonance in Hz
+ *        spins   = n pd t1 t2 cs0 cs1     n spins, cs linearly spaced in Hz
+ *        rf      = hard start end re im   hard pulse [T]
+ *        rf      = adiabatic start end b1 hyperbolic secant pulse
+ *        repeat  = start period count     rf and spoiler lines up to
+ *        repeat  = end                    (times within the period) form a
+ *                                         block played count times every
+ *                                         period from start, see RepeatRF
+ *        phases  = p0 p1 ...              block: phase of repetition k
+ *                                         [deg], cycled (phase cycling)
+ *        phases  = quadratic phi0         block: RF spoiling, phi0 k(k+1)/2
+ *        scales  = s0 s1 ...              block: amplitude of repetition
+ *                                         k, cycled (variable flip angles)
+ *        m0      = mx my mz               initial magnetisation (0 0 1)
+ *        time    = t0 t1                  time span (0 5)
+ *        output  = file.h5                output file (none: not written)
+ *        record  = final|signal|trajectory  final m of all spins (3 x n),
+ *                                         their sum (3 x 1) or every step
+ *                                         of a single spin
+ *        solver  = ode|epg                Bloch equations (ode) or extended
+ *                                         phase graphs (hard pulses only)
+ *        dephasing = dt                   EPG dephasing period [s]
+ *        spoiler = t [residual]           ideal spoiler at t, transverse
+ *                                         fraction left (0), ode only
+ *        spread  = lorentzian|uniform width [tol]  intra-voxel off-resonance
+ *                                         spread [Hz] of every spin, which
+ *                                         becomes the fewest isochromats
+ *                                         matching its free precession over
+ *                                         the time span to tol (1e-3), see
+ *                                         Voxel; ode only, final records
+ *                                         weighted isochromats; lorentzian
+ *                                         width > 0
+ *        checkpoint = file [interval [slices]]  checkpoint the run to file
+ *                                         every interval s of wall time
+ *                                         (60), trajectories in slices
+ *                                         (100) of the time span, see
+ *                                         Checkpoint; ode only, one file
+ *                                         per scenario, removed when the
+ *                                         run completes
+ *        incremental = file               keep the states at all event
+ *                                         boundaries in file, a re-run
+ *                                         resumes before the first changed
+ *                                         event, see Incremental; ode
+ *                                         final or signal, one file per
+ *                                         scenario
+ *        stepper, mode, abs_tol, rel_tol, dt   see StepperConfig
+ */
+template<class T> struct Scenario {
+
+	Scenario (const StepperConfig& c = StepperConfig()) :
+		t0(0.), t1(5.), stepper(c), record(RECORD_FINAL), solver(ODE_SOLVER),
+		dephasing(0.), spread(LORENTZIAN_SPREAD), width(0.), tolerance(1.e-3),
+		interval(60.), slices(100), in_repeat(false) {
+		m0[0] = 0.; m0[1] = 0.; m0[2] = 1.;
+	}
+
+	/**
+	 * @brief Set one parameter
+	 *
+	 * @return Success
+	 */
+	bool Set (const std::string& key, const std::string& value) {
+		std::istringstream iss (value);
+		if (key == "spin") {
+			T pd, t1s, t2s, cs = 0.;
+			iss >> pd >> t1s >> t2s;
+			if (iss.fail())
+				return Invalid (key, value);
+			iss >> cs;
+			sample.PushBack (Spin<T> (pd, 0., 0., 0., t1s, t2s, TWOPI*cs));
+		} else if (key == "spins") {
+			size_t n;
+			T pd, t1s, t2s, cs0, cs1;
+			iss >> n >> pd >> t1s >> t2s >> cs0 >> cs1;
+			if (iss.fail() || n == 0)
+				return Invalid (key, value);
+			for (size_t i = 0; i < n; ++i)
+				sample.PushBack (Spin<T> (pd, 0., 0., 0., t1s, t2s,
+						TWOPI * (cs0 + (n > 1 ? (cs1-cs0)*i/(n-1) : 0.))));
+		} else if (key == "rf") {
+			RFSpec r;
+			if (!r.Parse (value))
+				return Invalid (key, value);
+			if (in_repeat)
+				repeats.back().rfs.push_back (r);
+			else
+				rfs.push_back (r);
+		} else if (key == "repeat") {
+			if (value == "end") {
+				if (!in_repeat)
+					return Invalid (key, value);
+				in_repeat = false;
+				return true;
+			}
+			RepeatSpec<T> r;
+			iss >> r.start >> r.period >> r.count;
+			if (in_repeat || iss.fail() || r.period <= 0. || r.count == 0)
+				return Invalid (key, value);
+			repeats.push_back (r);
+			in_repeat = true;
+		} else if (key == "phases" || key == "scales") {
+			if (!in_repeat)
+				return Invalid (key, value);
+			std::vector<T>& table = (key == "phases") ? repeats.back().phases : repeats.back().scales;
+			std::string first;
+			iss >> first;
+			if (key == "phases" && first == "quadratic") {
+				double phi0;
+				iss >> phi0;
+				if (iss.fail())
+					return Invalid (key, value);
+				table = RepeatRF<T>::QuadraticPhases (repeats.back().count, phi0/360.*TWOPI);
+				return true;
+			}
+			table.clear();
+			std::istringstream values (value);
+			T v;
+			while (values >> v)
+				table.push_back ((key == "phases") ? v/360.*TWOPI : v);
+			if (table.empty() || !values.eof())
+				return Invalid (key, value);
+		} else if (key == "m0") {
+			iss >> m0[0] >> m0[1] >> m0[2];
+			if (iss.fail())
+				return Invalid (key, value);
+		} else if (key == "time") {
+			iss >> t0 >> t1;
+			if (iss.fail() || t1 <= t0)
+				return Invalid (key, value);
+		} else if (key == "output") {
+			output = value;
+		} else if (key == "record") {
+			if (value == "final")
+				record = RECORD_FINAL;
+			else if (value == "signal")
+				record = RECORD_SIGNAL;
+			else if (value == "trajectory")
+				record = RECORD_TRAJECTORY;
+			else
+				return Invalid (key, value);
+		} else if (key == "solver") {
+			if (value == "ode")
+				solver = ODE_SOLVER;
+			else if (value == "epg")
+				solver = EPG_SOLVER;
+			else
+				return Invalid (key, value);
+		} else if (key == "dephasing") {
+			iss >> dephasing;
+			if (iss.fail() || dephasing <= 0.)
+				return Invalid (key, value);
+		} else if (key == "spoiler") {
+			double t;
+			T residual = 0.;
+			iss >> t;
+			if (iss.fail())
+				return Invalid (key, value);
+			iss >> residual;
+			if (residual < 0. || residual > 1.)
+				return Invalid (key, value);
+			if (in_repeat) {
+				const RepeatSpec<T>& r = repeats.back();
+				spoilers.push_back (Spoiler<T> (r.start + t, residual, r.period, r.count));
+			} else {
+				spoilers.push_back (Spoiler<T> (t, residual));
+			}
+		} else if (key == "spread") {
+			std::string type;
+			iss >> type >> width;
+			if (iss.fail() || width < 0. || (type != "lorentzian" && type != "uniform") ||
+					(type == "lorentzian" && width == 0.))
+				return Invalid (key, value);
+			spread = (type == "lorentzian") ? LORENTZIAN_SPREAD : UNIFORM_SPREAD;
+			iss >> tolerance;
+			if (tolerance <= 0.)
+				return Invalid (key, value);
+		} else if (key == "incremental") {
+			if (value.empty())
+				return Invalid (key, value);
+			incremental = value;
+		} else if (key == "checkpoint") {
+			iss >> checkpoint;
+			if (iss.fail())
+				return Invalid (key, value);
+			iss >> interval;
+			if (!iss.fail())
+				iss >> slices;
+			if (interval < 0. || slices == 0)
+				return Invalid (key, value);
+		} else {
+			return stepper.Set (key, value);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Spins to simulate: the sample or, with a spread, isochromats
+	 *        standing in for each of its spins
+	 *
+	 * @param weights  Weights of the isochromats in their voxel's sum
+	 *                 (empty without spread)
+	 * @return         Spins
+	 */
+	Sample<T> Spins (std::vector<T>& weights) const {
+		weights.clear();
+		if (width <= 0.)
+			return sample;
+		Sample<T> ret;
+		// From the first step: no finite set follows a Lorentzian from 0
+		const size_t n = Voxel<T> (Spin<T>(), spread, width).Resolution (
+				std::min (stepper.dt, .5 * (t1 - t0)), t1 - t0, tolerance);
+		for (size_t i = 0; i < sample.Size(); ++i) {
+			std::vector<T> w;
+			const Sample<T> iso = Voxel<T> (sample[i], spread, width).Isochromats (n, t1 - t0, w);
+			for (size_t j = 0; j < n; ++j)
+				ret.PushBack (iso[j]);
+			weights.insert (weights.end(), w.begin(), w.end());
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief Complete and consistent
+	 */
+	bool Valid () const {
+		if (sample.Size() == 0) {
+			std::cerr << "Scenario " << name << ": no spins" << std::endl;
+			return false;
+		}
+		if (record == RECORD_TRAJECTORY && sample.Size() != 1) {
+			std::cerr << "Scenario " << name << ": trajectory needs a single spin" << std::endl;
+			return false;
+		}
+		if (solver == EPG_SOLVER && dephasing <= 0.) {
+			std::cerr << "Scenario " << name << ": epg needs a dephasing period" << std::endl;
+			return false;
+		}
+		if (in_repeat) {
+			std::cerr << "Scenario " << name << ": repeat without end" << std::endl;
+			return false;
+		}
+		if (solver == EPG_SOLVER && !repeats.empty()) {
+			std::cerr << "Scenario " << name << ": repeat blocks are for the ode solver" << std::endl;
+			return false;
+		}
+		if (solver == EPG_SOLVER && !spoilers.empty()) {
+			std::cerr << "Scenario " << name << ": spoilers are for the ode solver" << std::endl;
+			return false;
+		}
+		if (width > 0. && (solver == EPG_SOLVER || record == RECORD_TRAJECTORY)) {
+			std::cerr << "Scenario " << name << ": spread needs the ode solver and final or signal" << std::endl;
+			return false;
+		}
+		if (!checkpoint.empty() && solver == EPG_SOLVER) {
+			std::cerr << "Scenario " << name << ": checkpoints are for the ode solver" << std::endl;
+			return false;
+		}
+		if (!incremental.empty() && (solver == EPG_SOLVER || record == RECORD_TRAJECTORY ||
+				!checkpoint.empty())) {
+			std::cerr << "Scenario " << name << ": incremental needs the ode solver, final or signal and no checkpoint" << std::endl;
+			return false;
+		}
+		if (!stepper.Valid()) {
+			std::cerr << "Scenario " << name << ": unsupported stepper " << stepper << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::string name;
+	Sample<T> sample;
+	std::vector<RFSpec> rfs;
+	std::vector<Spoiler<T> > spoilers;
+	std::vector<RepeatSpec<T> > repeats;
+	state_type m0;
+	double t0, t1;
+	StepperConfig stepper;
+	std::string output;
+	RecordMode record;
+	Solver solver;
+	double dephasing;
+	Spread spread;
+	T width;
+	double tolerance;
+	std::string checkpoint;
+	double interval;
+	size_t slices;
+	std::string incremental;
+	bool in_repeat;
+
+private:
+
+	static bool Invalid (const std::string& key, const std::string& value) {
+		std::cerr << "Invalid scenario setting " << key << " = " << value << std::endl;
+		return false;
+	}
+
+};
+
+
+/**
+ * @brief Read scenarios from stream, appending to list
+ *
+ * @param ifs       Input stream
+ * @param list      Scenarios
+ * @param defaults  Stepper defaults (e.g. from command line)
+ * @param fname     Source name for messages
+ * @return          Success
+ */
+template<class T> bool
+ReadScenarios (std::istream& ifs, std::vector<Scenario<T> >& list,
+		const StepperConfig& defaults, const std::string& fname) {
+
+	size_t first = list.size(), ln = 0;
+	std::string line;
+	while (std::getline (ifs, line)) {
+		++ln;
+		line = line.substr(0, line.find('#'));
+		size_t b = line.find_first_not_of(" \t\r\n"), e = line.find_last_not_of(" \t\r\n");
+		if (b == std::string::npos)
+			continue;
+		line = line.substr(b, e-b+1);
+		if (line[0] == '[' && line[line.size()-1] == ']') {
+			list.push_back (Scenario<T>(defaults));
+			list.back().name = line.substr(1, line.size()-2);
+			continue;
+		}
+		size_t eq = line.find('=');
+		if (list.size() == first || eq == std::string::npos) {
+			std::cerr << fname << ":" << ln << ": expected [name] or key = value" << std::endl;
+			return false;
+		}
+		std::string key = line.substr(0, eq), value = line.substr(eq+1);
+		key   = key.substr(0, key.find_last_not_of(" \t")+1);
+		value = value.substr(std::min(value.find_first_not_of(" \t"), value.size()));
+		if (!list.back().Set (key, value)) {
+			std::cerr << fname << ":" << ln << std::endl;
+			return false;
+		}
+	}
+
+	for (size_t i = first; i < list.size(); ++i)
+		if (!list[i].Valid())
+			return false;
+
+	return true;
+
+}
+
+/**
+ * @brief Read scenarios from file, appending to list
+ *
+ * @param fname     Scenario file
+ * @param list      Scenarios
+ * @param defaults  Stepper defaults (e.g. from command line)
+ * @return          Success
+ */
+template<class T> bool
+ReadScenarios (const std::string& fname, std::vector<Scenario<T> >& list,
+		const StepperConfig& defaults = StepperConfig()) {
+	std::ifstream ifs (fname.c_str());
+	if (!ifs) {
+		std::cerr << "Cannot open " << fname << std::endl;
+		return false;
+	}
+	return ReadScenarios (ifs, list, defaults, fname);
+}
+
+
+/**
+ * @brief Runs scenarios in one process. RF events and open HDF5 output
+ *        files are kept for reuse by later scenarios; OpenMP keeps its
+ *        thread pool between the parallel regions of Simulate(). Under MPI
+ *        all ranks run every scenario on their shard of the sample, rank 0
+ *        collects and writes.
+ */
+template<class T> class Batch {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param restart  Scenarios resume from their checkpoints
+	 */
+	Batch (const bool restart = false) : _restart(restart), _written(true) {}
+
+	~Batch () {
+		for (typename std::map<RFSpec, RF<T>*>::iterator it = _rfs.begin(); it != _rfs.end(); ++it)
+			delete it->second;
+		for (std::map<std::string, HDF5File*>::iterator it = _files.begin(); it != _files.end(); ++it)
+			delete it->second;
+		ClearRepeats();
+	}
+
+	/**
+	 * @brief Run a scenario, write its output to group /name. Its
+	 *        temporaries (recorded trajectories) are drawn from an arena
+	 *        scope of its own, released on return.
+	 *
+	 * @param s  Scenario
+	 * @return   Final magnetisation (3 x spins, 3 x 1 for signal; empty
+	 *           on ranks other than 0 and for scenarios the solver rejects)
+	 */
+	NDData<double> Run (const Scenario<T>& s) {
+
+		ArenaScope scope;
+		_written = true;
+		Bloch<T>& env = Bloch<T>::Instance();
+		env.ClearEvents();
+		for (size_t i = 0; i < s.rfs.size(); ++i)
+			env.AddEvent (GetRF (s.rfs[i]));
+		for (size_t i = 0; i < s.spoilers.size(); ++i)
+			env.AddEvent (s.spoilers[i]);
+		ClearRepeats();
+		for (size_t i = 0; i < s.repeats.size(); ++i) {
+			const RepeatSpec<T>& r = s.repeats[i];
+			RepeatRF<T>* block = new RepeatRF<T> (r.start, r.period, r.count);
+			for (size_t j = 0; j < r.rfs.size(); ++j)
+				block->Add (GetRF (r.rfs[j]));
+			block->Scales (r.scales);
+			block->Phases (r.phases);
+			_repeats.push_back (block);
+			env.AddEvent (*block);
+		}
+
+		NDData<double> m;
+		const bool root = (Communicator::Rank() == 0);
+		HDF5File* f = (s.output.empty() || !root) ? 0 : GetFile (s.output);
+		std::string url = "/" + s.name;
+		Checkpoint checkpoint (s.checkpoint, s.interval, _restart);
+		if (!s.checkpoint.empty() && Communicator::Size() > 1 && root)
+			std::cerr << "Scenario " << s.name << ": checkpoints are single rank, none written" << std::endl;
+		Checkpoint* cp = (s.checkpoint.empty() || Communicator::Size() > 1) ? 0 : &checkpoint;
+
+		if (s.solver == EPG_SOLVER) {
+			EPG<T> epg (env.GetEvents(), s.dephasing, s.t0);
+			if (!epg.Valid() || !root) // Cheap, rank 0 only
+				return m;
+			if (s.record == RECORD_TRAJECTORY) {
+				Recorder<SAVE> recorder ("");
+				state_type x = s.m0;
+				epg.Run (s.sample[0], x, s.t1, boost::ref(recorder));
+				if (f)
+					CheckOutput (s, recorder.Write (*f, url));
+				m = NDData<double> (3, 1, ALLOC_NOINIT);
+				m[0] = x[0]; m[1] = x[1]; m[2] = x[2];
+			} else {
+				Sample<T> sample (s.sample);
+				m = epg.Simulate (sample, s.m0, s.t1);
+				if (s.record == RECORD_SIGNAL)
+					m = SumSpins (m);
+				if (f)
+					CheckOutput (s, f->Write (m, (s.record == RECORD_SIGNAL) ? "signal" : "m", url));
+			}
+		} else if (s.record == RECORD_TRAJECTORY) {
+			if (!root)
+				return m;
+			Recorder<SAVE> recorder ("");
+			state_type x = s.m0;
+			env.SetSpin (s.sample[0]);
+			if (cp)
+				Trajectory<T> (s.stepper, x, s.t0, s.t1, recorder, *cp, s.slices);
+			else
+				Integrate<T> (s.stepper, x, s.t0, s.t1, boost::ref(recorder));
+			m = NDData<double> (3, 1, ALLOC_NOINIT);
+			m[0] = x[0]; m[1] = x[1]; m[2] = x[2];
+			if (f)
+				CheckOutput (s, recorder.Write (*f, url));
+		} else {
+			std::vector<T> weights;
+			Sample<T> sample (s.Spins (weights));
+			const bool signal = (s.record == RECORD_SIGNAL);
+			if (!s.incremental.empty() && Communicator::Size() == 1) {
+				Incremental<T> incremental (s.incremental);
+				m = incremental.Simulate (sample, env, s.m0, s.t0, s.t1, s.stepper);
+				std::cerr << "Scenario " << s.name << ": resumed at t = " << incremental.Resumed()
+						  << ", " << incremental.Segments() << " segments per spin" << std::endl;
+				if (signal && weights.empty())
+					m = SumSpins (m);
+			} else {
+				if (!s.incremental.empty() && root)
+					std::cerr << "Scenario " << s.name << ": incremental is single rank, full run" << std::endl;
+				m = Simulate<MPI> (sample, env, s.m0, s.t0, s.t1, s.stepper,
+						(signal && weights.empty()) ? REDUCE : GATHER, cp);
+			}
+			if (!weights.empty() && m.Size()) { // Rank 0: weigh isochromats
+				for (size_t i = 0; i < weights.size(); ++i)
+					for (size_t c = 0; c < 3; ++c)
+						m(c,i) *= weights[i];
+				if (signal)
+					m = SumSpins (m);
+			}
+			if (f)
+				CheckOutput (s, f->Write (m, signal ? "signal" : "m", url));
+		}
+
+		return m;
+
+	}
+
+	/**
+	 * @brief Number of distinct RF events created
+	 */
+	inline size_t RFCacheSize () const { return _rfs.size(); }
+
+	/**
+	 * @brief Output of the last Run() written (true without output file)
+	 */
+	inline bool Written () const { return _written; }
+
+private:
+
+	void CheckOutput (const Scenario<T>& s, const codeare::io::IOStatus status) {
+		if (status == codeare::io::OK)
+			return;
+		std::cerr << "Scenario " << s.name << ": output not written to " << s.output << std::endl;
+		_written = false;
+	}
+
+	const RF<T>& GetRF (const RFSpec& r) {
+		typename std::map<RFSpec, RF<T>*>::iterator it = _rfs.find(r);
+		if (it != _rfs.end())
+			return *it->second;
+		RF<T>* rf = (r.type == HARD_RF) ?
+				(RF<T>*) new HardRF<T> (r.start, r.end, r.scale) :
+				(RF<T>*) new AdiabaticRF<T> (r.start, r.end, real(r.scale));
+		_rfs[r] = rf;
+		return *rf;
+	}
+
+	void ClearRepeats () {
+		for (size_t i = 0; i < _repeats.size(); ++i)
+			delete _repeats[i];
+		_repeats.clear();
+	}
+
+	HDF5File* GetFile (const std::string& fname) {
+		std::map<std::string, HDF5File*>::iterator it = _files.find(fname);
+		if (it != _files.end())
+			return it->second;
+		return (_files[fname] = new HDF5File (fname, OUT));
+	}
+
+	Batch (const Batch&);
+	Batch& operator= (const Batch&);
+
+	std::map<RFSpec, RF<T>*> _rfs;
+	std::map<std::string, HDF5File*> _files;
+	std::vector<RepeatRF<T>*> _repeats; // Of the current scenario
+	bool _restart;
+	bool _written; // Last Run()
+
+};
+
+#endif /* SCENARIO_HPP_ */
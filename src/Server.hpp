@@ -0,0 +1,337 @@
+/*
+ * Server.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SERVER_HPP_
+#define SERVER_HPP_
+
+#ifdef HAVE_CONFIG_H
+#    include "config.h"
+#endif
+
+#include "Scenario.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+
+#ifdef HAVE_UNISTD_H
+#    include <unistd.h>
+#endif
+#if defined (HAVE_SYS_SOCKET_H) && defined (HAVE_SYS_UN_H)
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    define HAVE_UNIX_SOCKETS 1
+#endif
+
+/**
+ * @brief Latency distribution in constant memory: log buckets, SUB per
+ *        power of two (quantiles within 1/SUB of an octave), exact count,
+ *        mean and max.
+ */
+class LatencyHistogram {
+
+public:
+
+	static const size_t SUB = 8; // Power of 2
+
+	LatencyHistogram () : _counts (64*SUB, 0), _n(0), _sum(0.), _max(0) {}
+
+	inline void Add (const uint64_t ns) {
+		++_counts[Bucket(ns)];
+		++_n;
+		_sum += ns;
+		_max = std::max (_max, ns);
+	}
+
+	inline uint64_t Count () const { return _n; }
+
+	inline double Mean () const { return _n ? _sum/_n : 0.; }
+
+	inline uint64_t Max () const { return _max; }
+
+	/**
+	 * @brief q-quantile, upper edge of its bucket (at most Max())
+	 */
+	uint64_t Quantile (const double q) const {
+		const uint64_t rank = std::max ((uint64_t) 1, (uint64_t) std::ceil (q*_n));
+		uint64_t sum = 0;
+		for (size_t b = 0; b < _counts.size(); ++b)
+			if ((sum += _counts[b]) >= rank)
+				return std::min (Upper(b), _max);
+		return _max;
+	}
+
+private:
+
+	/** Bucket of v: v itself below 2 SUB, else SUB per octave **/
+	static size_t Bucket (const uint64_t v) {
+		size_t e = 0, s = 0; // floor(log2 v), log2 SUB
+		while (((uint64_t) 1 << (s+1)) <= SUB)
+			++s;
+		while (e < 63 && (v >> (e+1)))
+			++e;
+		if (e <= s)
+			return v;
+		return (e-s+1)*SUB + (size_t) ((v >> (e-s)) - SUB);
+	}
+
+	/** Largest value in bucket b **/
+	static uint64_t Upper (const size_t b) {
+		size_t s = 0;
+		while (((uint64_t) 1 << (s+1)) <= SUB)
+			++s;
+		if (b < 2*SUB)
+			return b;
+		const size_t e = b/SUB + s - 1, w = e - s;
+		return (((uint64_t) (SUB + b%SUB)) << w) + ((uint64_t) 1 << w) - 1;
+	}
+
+	std::vector<uint64_t> _counts;
+	uint64_t _n;
+	double _sum;
+	uint64_t _max;
+
+};
+
+
+/**
+ * @brief Simulation server. Answers scenario requests on a byte stream
+ *        (stdin/stdout or a Unix domain socket connection) in arrival order.
+ *        Requests may be pipelined: clients can send any number of requests
+ *        before reading responses. RF events and output files stay cached in
+ *        the Batch, OpenMP threads stay warm between requests.
+ *
+ *        Frames, integers in host byte order:
+ *
+ *        Request:  uint32 size, size bytes scenario text (one scenario, the
+ *                  [name] line may be omitted). size 0 stops the server.
+ *        Response: uint32 size (bytes after this field)
+ *                  uint32 id          request number, from 0
+ *                  int32  status      0 ok, 1 invalid request, 2 run
+ *                                     failed (no result or output not
+ *                                     written)
+ *                  uint32 rows, cols  result dimensions (3 x spins)
+ *                  uint64 latency_ns  receipt to response
+ *                  rows*cols doubles  final magnetisation, column major
+ *                  (status != 0: error text instead)
+ */
+template<class T> class Server {
+
+public:
+
+	static const uint32_t MAX_REQUEST = 1 << 26;
+	static const size_t   HEADER_SIZE = 28;
+
+	Server (const StepperConfig& defaults = StepperConfig()) :
+		_defaults(defaults), _id(0), _stop(false) {}
+
+	/**
+	 * @brief Serve one stream until EOF or stop request
+	 *
+	 * @param in   Input file descriptor
+	 * @param out  Output file descriptor
+	 * @return     Success (false on I/O error or bad frame)
+	 */
+	bool Serve (const int in, const int out) {
+		std::string request;
+		std::vector<char> response;
+		while (!_stop) {
+			uint32_t size;
+			const ssize_t r = ReadFull (in, &size, sizeof(size));
+			if (r == 0)
+				return true; // EOF between requests
+			if (r != (ssize_t) sizeof(size))
+				return false; // Error or header cut short
+			if (size == 0) {
+				_stop = true;
+				break;
+			}
+			if (size > MAX_REQUEST)
+				return false;
+			request.resize (size);
+			if (ReadFull (in, &request[0], size) != (ssize_t) size)
+				return false;
+			Timer timer;
+			Respond (request, response, timer);
+			if (!WriteFull (out, &response[0], response.size()))
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Listen on Unix domain socket, serve connections one at a time
+	 *        until a stop request
+	 *
+	 * @param path  Socket path (replaced if it exists)
+	 * @return      Success
+	 */
+	bool Listen (const std::string& path) {
+#ifdef HAVE_UNIX_SOCKETS
+		sockaddr_un addr;
+		if (path.size() >= sizeof(addr.sun_path)) {
+			std::cerr << "Socket path too long: " << path << std::endl;
+			return false;
+		}
+		int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			perror ("socket");
+			return false;
+		}
+		memset (&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy (addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+		unlink (path.c_str());
+		if (bind (fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen (fd, 16) < 0) {
+			perror ("bind/listen");
+			close (fd);
+			return false;
+		}
+		signal (SIGPIPE, SIG_IGN); // Lost clients show as write errors
+		std::cerr << "Listening on " << path << std::endl;
+		while (!_stop) {
+			int conn = accept (fd, 0, 0);
+			if (conn < 0) {
+				if (errno == EINTR)
+					continue;
+				perror ("accept");
+				break;
+			}
+			if (!Serve (conn, conn))
+				std::cerr << "Connection dropped" << std::endl;
+			close (conn);
+		}
+		close (fd);
+		unlink (path.c_str());
+		return _stop;
+#else
+		std::cerr << "No Unix domain sockets on this platform, serve stdin" << std::endl;
+		return false;
+#endif
+	}
+
+	/**
+	 * @brief Per request latency summary
+	 */
+	std::ostream& Report (std::ostream& os) const {
+		const LatencyHistogram& l = _latencies;
+		if (l.Count() == 0)
+			return os << "0 requests" << std::endl;
+		return os << l.Count() << " requests, latency mean " << 1.e-3*l.Mean()
+				  << "us p50 " << 1.e-3*l.Quantile(.5) << "us p99 "
+				  << 1.e-3*l.Quantile(.99) << "us max " << 1.e-3*l.Max() << "us" << std::endl;
+	}
+
+	inline const LatencyHistogram& Latencies () const { return _latencies; }
+
+private:
+
+	/**
+	 * @brief Run request, build response frame
+	 */
+	void Respond (const std::string& request, std::vector<char>& response, const Timer& timer) {
+
+		std::vector<Scenario<T> > list;
+		size_t b = request.find_first_not_of(" \t\r\n");
+		std::istringstream iss ((b != std::string::npos && request[b] == '[') ?
+				request : "[request]\n" + request);
+		std::stringstream id;
+		id << "request " << _id;
+
+		int32_t status = 0;
+		NDData<double> m;
+		std::string error;
+		if (ReadScenarios (iss, list, _defaults, id.str()) && list.size() == 1) {
+			m = _batch.Run (list[0]);
+			if (m.Empty()) {
+				status = 2;
+				error  = "Scenario " + list[0].name + " gave no result";
+			} else if (!_batch.Written()) {
+				status = 2;
+				error  = "Scenario " + list[0].name + ": output not written to " + list[0].output;
+			}
+		} else {
+			status = 1;
+			error  = "Invalid request, expected one scenario";
+		}
+
+		uint32_t rows = status ? 0 : m.Dim(0), cols = status ? 0 : m.Dim(1);
+		size_t payload = status ? error.size() : m.Size()*sizeof(double);
+		response.resize (HEADER_SIZE + payload);
+		char* p = &response[0];
+		uint32_t size = HEADER_SIZE - sizeof(uint32_t) + payload;
+		Put (p, size); Put (p, _id); Put (p, status); Put (p, rows); Put (p, cols);
+		char* lp = p; // latency last
+		p += sizeof(uint64_t);
+		if (status)
+			memcpy (p, error.data(), error.size());
+		else
+			memcpy (p, m.Ptr(), payload);
+
+		uint64_t latency = timer.Lap();
+		Put (lp, latency);
+		_latencies.Add (latency);
+		++_id;
+
+	}
+
+	template<class V> inline static void Put (char*& p, const V v) {
+		memcpy (p, &v, sizeof(V));
+		p += sizeof(V);
+	}
+
+	/** Bytes read, fewer than n at EOF, -1 on error **/
+	static ssize_t ReadFull (const int fd, void* buf, size_t n) {
+		char* p = (char*) buf;
+		ssize_t got = 0;
+		while (n) {
+			ssize_t r = read (fd, p, n);
+			if (r < 0 && errno == EINTR)
+				continue;
+			if (r < 0)
+				return -1;
+			if (r == 0)
+				break;
+			p += r;
+			n -= r;
+			got += r;
+		}
+		return got;
+	}
+
+	static bool WriteFull (const int fd, const void* buf, size_t n) {
+		const char* p = (const char*) buf;
+		while (n) {
+			ssize_t w = write (fd, p, n);
+			if (w < 0 && errno == EINTR)
+				continue;
+			if (w <= 0)
+				return false;
+			p += w;
+			n -= w;
+		}
+		return true;
+	}
+
+	Batch<T> _batch;
+	StepperConfig _defaults;
+	LatencyHistogram _latencies;
+	uint32_t _id;
+	bool _stop;
+
+};
+
+#endif /* SERVER_HPP_ */
@@ -0,0 +1,341 @@
+/*
+ * Simulation.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SIMULATION_HPP_
+#define SIMULATION_HPP_
+
+#include "Bloch.hpp"
+#include "Checkpoint.hpp"
+#include "Recorder.hpp"
+#include "Sample.hpp"
+#include "Stats.hpp"
+#include "Stepper.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Hash of what a run depends on besides its events: m0, t0, all
+ *        stepper settings and the parameters of every spin
+ *
+ * @param spins   Spins
+ * @param n       Number of spins
+ * @param m0      Initial magnetisation
+ * @param t0      Start time
+ * @param c       Stepper configuration
+ * @return        Hash
+ */
+template<class T> uint64_t
+RunHash (const Spin<T>* spins, const size_t n, const state_type& m0, const double t0,
+		const StepperConfig& c) {
+	uint64_t h = fnv1a (&m0[0], 3*sizeof(double));
+	h = fnv1a (&t0, sizeof(t0), h);
+	h = fnv1a (&c.type, sizeof(c.type), h);
+	h = fnv1a (&c.mode, sizeof(c.mode), h);
+	h = fnv1a (&c.abs_tol, sizeof(c.abs_tol), h);
+	h = fnv1a (&c.rel_tol, sizeof(c.rel_tol), h);
+	h = fnv1a (&c.dt, sizeof(c.dt), h);
+	h = fnv1a (&c.frame, sizeof(c.frame), h);
+	for (size_t i = 0; i < n; ++i) {
+		const T p[7] = { spins[i].pd(), spins[i].rx(), spins[i].ry(), spins[i].rz(),
+				spins[i].t1(), spins[i].t2(), spins[i].cs() };
+		h = fnv1a (p, sizeof(p), h);
+	}
+	return h;
+}
+
+template<class T> inline uint64_t
+RunHash (const Sample<T>& sample, const state_type& m0, const double t0,
+		const StepperConfig& c) {
+	return sample.Size() ? RunHash (&sample[0], sample.Size(), m0, t0, c) :
+			RunHash ((const Spin<T>*) 0, 0, m0, t0, c);
+}
+
+/** Not in (t0, t1) **/
+struct OutsideSpan {
+	OutsideSpan (const double t0, const double t1) : _t0(t0), _t1(t1) {}
+	inline bool operator() (const double t) const { return t <= _t0 || t >= _t1; }
+	double _t0, _t1;
+};
+
+/**
+ * @brief Start and hash of every RF event and spoiler of env, sorted
+ */
+template<class T> void
+EventHashes (const Bloch<T>& env, std::vector<std::pair<double,uint64_t> >& events) {
+	const std::vector<const RF<T>*>& rfs = env.GetEvents();
+	const std::vector<const Spoiler<T>*>& spoilers = env.GetSpoilers();
+	for (size_t e = 0; e < rfs.size(); ++e)
+		events.push_back (std::make_pair (rfs[e]->TPOIs().front(), rfs[e]->Hash()));
+	for (size_t e = 0; e < spoilers.size(); ++e)
+		events.push_back (std::make_pair (spoilers[e]->Time(), spoilers[e]->Hash()));
+	std::sort (events.begin(), events.end());
+}
+
+/**
+ * @brief Event boundaries of env: t0, TPOIs of the RF events, starts of
+ *        every repetition of repeat blocks and every spoiler time in
+ *        (t0, t1), t1. And start and hash of every event, repeat blocks
+ *        and spoilers per repetition (see RepeatRF::HashRepetition()), sorted.
+ */
+template<class T> void
+Boundaries (const Bloch<T>& env, const double t0, const double t1,
+		std::vector<double>& times, std::vector<std::pair<double,uint64_t> >& events) {
+	const std::vector<const RF<T>*>& rfs = env.GetEvents();
+	const std::vector<const Spoiler<T>*>& spoilers = env.GetSpoilers();
+	for (size_t e = 0; e < rfs.size(); ++e) {
+		if (rfs[e]->Type() == REPEAT_RF) {
+			const RepeatRF<T>& r = *(const RepeatRF<T>*) rfs[e];
+			for (size_t k = 0; k < r.Count(); ++k) {
+				times.push_back (r.Start(k));
+				events.push_back (std::make_pair (r.Start(k), r.HashRepetition(k)));
+			}
+			times.push_back (r.Start (r.Count()));
+		} else {
+			const std::vector<double>& tp = rfs[e]->TPOIs();
+			times.insert (times.end(), tp.begin(), tp.end());
+			events.push_back (std::make_pair (tp.front(), rfs[e]->Hash()));
+		}
+	}
+	for (size_t e = 0; e < spoilers.size(); ++e)
+		for (size_t k = 0; k < spoilers[e]->Count(); ++k) {
+			times.push_back (spoilers[e]->Time(k));
+			events.push_back (std::make_pair (spoilers[e]->Time(k), spoilers[e]->HashRepetition()));
+		}
+	std::sort (events.begin(), events.end());
+	std::sort (times.begin(), times.end());
+	times.erase (std::unique (times.begin(), times.end()), times.end());
+	times.erase (std::remove_if (times.begin(), times.end(), OutsideSpan (t0, t1)), times.end());
+	times.insert (times.begin(), t0);
+	times.push_back (t1);
+}
+
+/**
+ * @brief Hash of a whole run: RunHash() and every event
+ */
+template<class T> uint64_t
+RunHash (const Bloch<T>& env, const Spin<T>* spins, const size_t n, const state_type& m0,
+		const double t0, const StepperConfig& c) {
+	std::vector<std::pair<double,uint64_t> > events;
+	EventHashes (env, events);
+	uint64_t h = RunHash (spins, n, m0, t0, c);
+	return events.empty() ? h : fnv1a (&events[0], events.size()*sizeof(events[0]), h);
+}
+
+
+/**
+ * @brief Take processed spins and their magnetisation from a checkpoint
+ *        of the same run
+ *
+ * @param checkpoint  Checkpoint
+ * @param run         Run description
+ * @param sample      Sample (checkpointed spins are marked processed)
+ * @param m           Magnetisation (3 x spins)
+ * @return            Resumed
+ */
+template<class T> bool
+Resume (const Checkpoint& checkpoint, const Snapshot& run, Sample<T>& sample,
+		NDData<double>& m) {
+	Snapshot s;
+	if (!checkpoint.Load (s))
+		return false;
+	if (!s.Matches (run) || s.slices || s.m.Size() != 3 * s.done.size()) {
+		std::cerr << "Checkpoint " << checkpoint.File() << " is of another run, starting over" << std::endl;
+		return false;
+	}
+	for (size_t j = 0; j < s.done.size(); ++j)
+		for (size_t c = 0; c < 3; ++c)
+			m(c,s.done[j]) = s.m(c,j);
+	sample.Resume (s.done);
+	return true;
+}
+
+/**
+ * @brief Save the processed spins of a sample and their magnetisation
+ *
+ * @param checkpoint  Checkpoint
+ * @param run         Run description
+ * @param sample      Sample
+ * @param m           Magnetisation (3 x spins)
+ */
+template<class T> void
+Save (Checkpoint& checkpoint, const Snapshot& run, const Sample<T>& sample,
+		const NDData<double>& m) {
+	Snapshot s (run);
+	s.done = sample.Processed();
+	std::vector<bool> done (sample.Size(), false);
+	s.m = NDData<double> (3, s.done.size(), ALLOC_NOINIT);
+	for (size_t j = 0; j < s.done.size(); ++j) {
+		done[s.done[j]] = true;
+		for (size_t c = 0; c < 3; ++c)
+			s.m(c,j) = m(c,s.done[j]);
+	}
+	for (size_t i = 0; i < sample.Size(); ++i) // Untouched and in progress
+		if (!done[i])
+			s.untouched.push_back (i);
+	checkpoint.Save (s);
+}
+
+/**
+ * @brief Simulate all spins of a sample from t0 to t1, spins distributed
+ *        over threads. Each thread works on a copy of env. With a
+ *        checkpoint, processed spins are saved whenever it is due, a
+ *        restart of the same run (see RunHash()) skips the spins of the
+ *        last checkpoint. The checkpoint is removed once all spins are done.
+ *
+ * @param sample      Sample (processed spins are turned in)
+ * @param env         Simulation environment (events)
+ * @param m0          Initial magnetisation
+ * @param t0          Start time
+ * @param t1          End time
+ * @param config      Stepper configuration
+ * @param checkpoint  Checkpoint (none: 0)
+ * @return            Final magnetisation (3 x spins)
+ */
+template<class T> NDData<double>
+Simulate (Sample<T>& sample, const Bloch<T>& env, const state_type& m0,
+		const double t0, const double t1, const StepperConfig& config = StepperConfig(),
+		Checkpoint* checkpoint = 0) {
+
+	NDData<double> m (3, sample.Size(), ALLOC_NOINIT);
+	const Snapshot run (t0, t1, config.dt, m0, sample.Size(), 0, sample.Size() ?
+			RunHash (env, &sample[0], sample.Size(), m0, t0, config) : 0);
+	if (checkpoint && checkpoint->Restart())
+		Resume (*checkpoint, run, sample, m);
+
+#pragma omp parallel
+	{
+		Bloch<T>& local = Bloch<T>::Instance();
+		if (&local != &env)
+			local = env;
+#pragma omp barrier
+
+		while (true) {
+
+			size_t n = 0;
+			const Spin<T>* spin = 0;
+#pragma omp critical (sample)
+			if (!sample.Done())
+				spin = &sample.GetNext(n);
+			if (!spin)
+				break;
+
+			STATS_TIMER(timer);
+			local.SetSpin (*spin);
+			state_type x = m0;
+			Integrate<T> (config, x, t0, t1, boost::numeric::odeint::null_observer());
+			m(0,n) = x[0];
+			m(1,n) = x[1];
+			m(2,n) = x[2];
+
+#pragma omp critical (sample)
+			{
+				sample.TurnIn (n);
+				if (checkpoint && checkpoint->Due())
+					Save (*checkpoint, run, sample, m);
+			}
+			STATS_INC(SPINS);
+			STATS_ADD(SPIN_NS, timer.Lap());
+
+		}
+	}
+
+	if (checkpoint)
+		checkpoint->Complete();
+
+	return m;
+
+}
+
+/**
+ * @brief Start of slice k of n of [t0, t1] (exactly t1 for k = n)
+ */
+inline static double
+Slice (const double t0, const double t1, const size_t n, const size_t k) {
+	return (k == n) ? t1 : t0 + (t1 - t0) * k / n;
+}
+
+/**
+ * @brief Observer passing on all but the first call: a slice starts where
+ *        the previous one, recorded already, ended
+ */
+template<class Observer> struct continue_observer {
+	continue_observer (Observer& obs) : _obs(obs), _first(true) {}
+	inline void operator() (const state_type& m, const double t) {
+		if (_first)
+			_first = false;
+		else
+			_obs (m, t);
+	}
+	Observer& _obs;
+	bool _first;
+};
+
+/**
+ * @brief Integrate the calling thread's environment from t0 to t1 recording
+ *        every step, in slices (t1-t0)/slices each starting with config.dt.
+ *        The checkpoint at the end of a slice (when due) holds all a
+ *        restart of the same run (see RunHash()) needs to go on as the run
+ *        did, result and records are bit for bit those of an uninterrupted
+ *        run. The checkpoint is removed once t1 is reached.
+ *
+ * @param config      Stepper configuration
+ * @param m           Magnetisation (m0 in, m(t1) out)
+ * @param t0          Start time
+ * @param t1          End time
+ * @param recorder    Recorder
+ * @param checkpoint  Checkpoint
+ * @param slices      Number of slices
+ * @return            Steps (of this process)
+ */
+template<class T> size_t
+Trajectory (const StepperConfig& config, state_type& m, const double t0, const double t1,
+		Recorder<SAVE>& recorder, Checkpoint& checkpoint, const size_t slices) {
+
+	const Bloch<T>& env = Bloch<T>::Instance();
+	const Snapshot run (t0, t1, config.dt, m, 1, slices,
+			RunHash (env, &env.GetSpin(), 1, m, t0, config));
+	size_t k = 0, steps = 0;
+	Snapshot s;
+	if (checkpoint.Restart() && checkpoint.Load (s)) {
+		while (k <= slices && Slice (t0, t1, slices, k) != s.t)
+			++k;
+		if (s.Matches (run) && k <= slices && s.m.Size() == 3) {
+			m[0] = s.m[0]; m[1] = s.m[1]; m[2] = s.m[2];
+			recorder.Assign (s.times, s.data);
+		} else {
+			std::cerr << "Checkpoint " << checkpoint.File() << " is of another run, starting over" << std::endl;
+			k = 0;
+		}
+	}
+
+	for (; k < slices; ++k) {
+		const double a = Slice (t0, t1, slices, k), b = Slice (t0, t1, slices, k+1);
+		if (recorder.Size()) {
+			continue_observer<Recorder<SAVE> > obs (recorder);
+			steps += Integrate<T> (config, m, a, b, boost::ref(obs));
+		} else {
+			steps += Integrate<T> (config, m, a, b, boost::ref(recorder));
+		}
+		if (k+1 < slices && checkpoint.Due()) {
+			s = run;
+			s.t = b;
+			s.m = NDData<double> (3, 1, ALLOC_NOINIT);
+			s.m[0] = m[0]; s.m[1] = m[1]; s.m[2] = m[2];
+			recorder.Get (s.times, s.data);
+			checkpoint.Save (s);
+		}
+	}
+	checkpoint.Complete();
+
+	return steps;
+
+}
+
+#endif /* SIMULATION_HPP_ */
@@ -0,0 +1,196 @@
+/*
+ * SplitNDData.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SPLITNDDATA_HPP_
+#define SPLITNDDATA_HPP_
+
+#include "NDData.hpp"
+
+#include <complex>
+
+/**
+ * @brief  Complex nd-data in split layout, i.e. separate real and imaginary
+ *         planes instead of interleaved std::complex pairs. Complex arithmetic
+ *         on the planes vectorises without shuffles.
+ */
+template<class T>
+class SplitNDData {
+
+	typedef std::complex<T> CT;
+
+public:
+
+	/**
+	 * @brief Default constructor
+	 */
+	SplitNDData () {}
+
+	/**
+	 * @brief ND-Data
+	 *
+	 * @param dims  Side lengths
+	 * @param mode  Allocation mode of both planes
+	 */
+	explicit SplitNDData (const codeare::container<size_t>& dims,
+			const AllocMode mode = ALLOC_DEFAULT) :
+		_re(dims, mode), _im(dims, mode) {}
+
+	/**
+	 * @brief 1D-data (convenience constructor)
+	 *
+	 * @param n0    Vector length
+	 * @param mode  Allocation mode of both planes
+	 */
+	explicit SplitNDData (const size_t n0, const AllocMode mode = ALLOC_DEFAULT) :
+		_re(n0, mode), _im(n0, mode) {}
+
+	/**
+	 * @brief From real and imaginary planes
+	 *
+	 * @param re  Real plane
+	 * @param im  Imaginary plane
+	 */
+	SplitNDData (const NDData<T>& re, const NDData<T>& im) : _re(re), _im(im) {
+		assert (re.Dims().data() == im.Dims().data());
+	}
+
+	/**
+	 * @brief Deinterleave
+	 *
+	 * @param data  Interleaved complex data
+	 */
+	explicit SplitNDData (const NDData<CT>& data) :
+		_re(data.Dims(), ALLOC_NOINIT), _im(data.Dims(), ALLOC_NOINIT) {
+		const CT* d = data.Ptr();
+		T* re = _re.Ptr();
+		T* im = _im.Ptr();
+		const size_t n = data.Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i) {
+			re[i] = d[i].real();
+			im[i] = d[i].imag();
+		}
+	}
+
+	/**
+	 * @brief Interleave
+	 *
+	 * @return  Interleaved complex data
+	 */
+	NDData<CT> Interleaved () const {
+		NDData<CT> ret (_re.Dims(), ALLOC_NOINIT);
+		CT* d = ret.Ptr();
+		const T* re = _re.Ptr();
+		const T* im = _im.Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i)
+			d[i] = CT(re[i], im[i]);
+		return ret;
+	}
+
+	/**
+	 * @brief Real / imaginary plane (no copy)
+	 */
+	inline NDData<T>& Real () { return _re; }
+	inline const NDData<T>& Real () const { return _re; }
+	inline NDData<T>& Imag () { return _im; }
+	inline const NDData<T>& Imag () const { return _im; }
+
+	inline size_t Dim (const size_t n = 0) const { return _re.Dim(n); }
+	inline const codeare::container<size_t>& Dims () const { return _re.Dims(); }
+	inline size_t Size () const { return _re.Size(); }
+	inline size_t NDim () const { return _re.NDim(); }
+	inline bool Empty () const { return _re.Empty(); }
+
+	inline CT operator[] (const size_t p) const { return CT(_re[p], _im[p]); }
+	inline CT operator() (const size_t p) const { return CT(_re[p], _im[p]); }
+	inline void Set (const size_t p, const CT c) {
+		_re[p] = c.real();
+		_im[p] = c.imag();
+	}
+
+	/**
+	 * @brief Fused complex multiply-accumulate this += a * b on the planes
+	 *
+	 * @param a  Factor
+	 * @param b  Factor
+	 */
+	SplitNDData& MulAcc (const SplitNDData& a, const SplitNDData& b) {
+		assert (a.Size() == Size() && b.Size() == Size());
+		T* re = _re.Ptr();
+		T* im = _im.Ptr();
+		const T *are = a._re.Ptr(), *aim = a._im.Ptr(),
+				*bre = b._re.Ptr(), *bim = b._im.Ptr();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i) {
+			const T ar = are[i], ai = aim[i], br = bre[i], bi = bim[i]; // a, b may alias this
+			re[i] += ar*br - ai*bi;
+			im[i] += ar*bi + ai*br;
+		}
+		return *this;
+	}
+
+	template<class S> inline SplitNDData&
+	operator*= (const S s) {
+		_re *= s;
+		_im *= s;
+		return *this;
+	}
+
+	/**
+	 * @brief Multiply by complex scalar
+	 */
+	inline SplitNDData&
+	operator*= (const CT c) {
+		T* re = _re.Ptr();
+		T* im = _im.Ptr();
+		const T cr = c.real(), ci = c.imag();
+		const size_t n = Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+		for (size_t i = 0; i < n; ++i) {
+			const T r = re[i];
+			re[i] = r*cr - im[i]*ci;
+			im[i] = r*ci + im[i]*cr;
+		}
+		return *this;
+	}
+
+private:
+
+	NDData<T> _re; /**< real plane */
+	NDData<T> _im; /**< imaginary plane */
+
+};
+
+template <class T> inline static const NDData<T>&
+real (const SplitNDData<T>& data) {
+	return data.Real();
+}
+template <class T> inline static const NDData<T>&
+imag (const SplitNDData<T>& data) {
+	return data.Imag();
+}
+template <class T> inline static NDData<T>
+abs (const SplitNDData<T>& data) {
+	NDData<T> ret (data.Dims(), ALLOC_NOINIT);
+	const T* re = data.Real().Ptr();
+	const T* im = data.Imag().Ptr();
+	T* r = ret.Ptr();
+	const size_t n = ret.Size();
+#pragma omp parallel for simd schedule(static) if (n > PAR_THRESHOLD)
+	for (size_t i = 0; i < n; ++i)
+		r[i] = sqrt(re[i]*re[i] + im[i]*im[i]);
+	return ret;
+}
+template <class T> inline static size_t
+numel (const SplitNDData<T>& data) {
+	return data.Size();
+}
+
+#endif /* SPLITNDDATA_HPP_ */
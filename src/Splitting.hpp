@@ -0,0 +1,141 @@
+/*
+ * Splitting.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SPLITTING_HPP_
+#define SPLITTING_HPP_
+
+#include "Bloch.hpp"
+#include "Stats.hpp"
+
+#include <boost/array.hpp>
+#include <boost/numeric/odeint/stepper/stepper_categories.hpp>
+
+#include <cmath>
+
+/**
+ * @brief Rotation of a splitting step
+ */
+enum SplittingScheme {
+	MIDPOINT_SPLITTING, /**< @brief About the field at the step midpoint
+	                                (exponential midpoint, 1 field per step) */
+	MAGNUS4_SPLITTING   /**< @brief Fourth order Magnus expansion from the
+	                                field at the 2 Gauss points */
+};
+
+/**
+ * @brief Field b [rad/s] of the calling thread's environment at t, such
+ *        that without relaxation dm/dt = -b x m
+ *
+ * @param t           Time
+ * @param spin_frame  In the frame rotating at the spin's cs (no bz, RF
+ *                    phase modulated), see bloch_spin_frame()
+ * @param b           Field
+ */
+template<class T> inline void
+bloch_field (const double t, const bool spin_frame, double* b) {
+	STATS_INC(RHS_CALLS);
+	const Bloch<T>& env = Bloch<T>::Instance();
+	std::complex<T> rf = env.GetRF(t);
+	if (spin_frame && rf != std::complex<T>(0.,0.))
+		rf *= std::polar ((T)1., (T)(env.GetSpin().cs()*t));
+	b[0] = GAMMA*real(rf);
+	b[1] = GAMMA*imag(rf);
+	b[2] = spin_frame ? 0. : env.GetSpin().cs();
+}
+
+/**
+ * @brief Strang splitting stepper for the Bloch equations of the calling
+ *        thread's environment (odeint stepper concept, fixed steps): half
+ *        a step of exact relaxation, one exact rotation, half a step of
+ *        relaxation. The rotation keeps |m|, relaxation only draws m to
+ *        equilibrium, so m stays bounded at any step size. Second order
+ *        (relaxation and rotation do not commute); with MAGNUS4_SPLITTING
+ *        the rotation alone is fourth order, which pays off for pulses
+ *        much shorter than T2. The system passed to do_step() is not
+ *        evaluated, the field is taken from the environment.
+ */
+template<class T> class splitting_stepper {
+
+public:
+
+	typedef ::state_type state_type;
+	typedef ::state_type deriv_type;
+	typedef double value_type;
+	typedef double time_type;
+	typedef unsigned short order_type;
+	typedef boost::numeric::odeint::stepper_tag stepper_category;
+
+	static const order_type order_value = 2;
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param scheme      Rotation
+	 * @param spin_frame  Integrate in the spin frame (m in that frame)
+	 */
+	splitting_stepper (const SplittingScheme scheme = MIDPOINT_SPLITTING,
+			const bool spin_frame = false) :
+		_scheme(scheme), _spin_frame(spin_frame), _dt(0.), _e1(1.), _e2(1.) {}
+
+	order_type order () const { return order_value; }
+
+	/**
+	 * @brief Step m from t to t + dt
+	 */
+	template<class System> void
+	do_step (System, state_type& m, const time_type t, const time_type dt) {
+
+		const Spin<T>& spin = Bloch<T>::Instance().GetSpin();
+		if (dt != _dt) { // Fixed steps: once per integration
+			_dt = dt;
+			_e1 = std::exp(-.5*dt/spin.t1());
+			_e2 = std::exp(-.5*dt/spin.t2());
+		}
+		const double pd = spin.pd();
+
+		Relax (m, pd);
+
+		double b[3];
+		if (_scheme == MIDPOINT_SPLITTING) {
+			bloch_field<T> (t + .5*dt, _spin_frame, b);
+		} else { // Omega = h/2 (A1 + A2) + sqrt(3)/12 h^2 [A2, A1], A = -b x
+			const double g = std::sqrt(3.)/6.;
+			double b1[3], b2[3];
+			bloch_field<T> (t + (.5-g)*dt, _spin_frame, b1);
+			bloch_field<T> (t + (.5+g)*dt, _spin_frame, b2);
+			const double c = .5*g*dt;
+			b[0] = .5*(b1[0]+b2[0]) + c*(b1[1]*b2[2] - b1[2]*b2[1]);
+			b[1] = .5*(b1[1]+b2[1]) + c*(b1[2]*b2[0] - b1[0]*b2[2]);
+			b[2] = .5*(b1[2]+b2[2]) + c*(b1[0]*b2[1] - b1[1]*b2[0]);
+		}
+		boost::array<double,9> R;
+		rotation_matrix (b[0], b[1], b[2], dt, R);
+		const double x = m[0], y = m[1], z = m[2];
+		m[0] = R[0]*x + R[3]*y + R[6]*z;
+		m[1] = R[1]*x + R[4]*y + R[7]*z;
+		m[2] = R[2]*x + R[5]*y + R[8]*z;
+
+		Relax (m, pd);
+
+	}
+
+private:
+
+	/** Exact relaxation over dt/2 **/
+	inline void Relax (state_type& m, const double pd) const {
+		m[0] *= _e2;
+		m[1] *= _e2;
+		m[2]  = pd + (m[2] - pd)*_e1;
+	}
+
+	SplittingScheme _scheme;
+	bool _spin_frame;
+	double _dt, _e1, _e2;
+
+};
+
+#endif /* SPLITTING_HPP_ */
@@ -0,0 +1,122 @@
+/*
+ * Spoiler.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef SPOILER_HPP_
+#define SPOILER_HPP_
+
+#include "Event.hpp"
+
+#include <assert.h>
+#include <limits>
+
+/**
+ * @brief Idealised spoiler: Instantaneously scales the transverse
+ *        magnetisation by a residual fraction (0: perfect spoiling), in
+ *        place of the dephasing of many isochromats by a spoiler gradient.
+ *        Applied by the integration driver, which integrates up to the
+ *        spoiler, applies it and continues (see Integrate()). Repeated
+ *        (e.g. at the end of every TR of a repeat block, see RepeatRF) at
+ *        t + k period, k < count.
+ */
+template<class T>
+class Spoiler : public Event<T> {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param t         Time (of the first)
+	 * @param residual  Transverse fraction left (0 ... 1)
+	 * @param period    Period of repetitions
+	 * @param count     Number of repetitions
+	 */
+	Spoiler (const double t = 0., const T residual = 0., const double period = 0.,
+			const size_t count = 1) :
+		Event<T> (t, t + (count-1) * period), _residual(residual), _period(period),
+		_count(count) {
+		assert (residual >= 0. && residual <= 1.);
+		assert (count > 0 && (count == 1 || period > 0.));
+		this->_etype = SPOILER_E;
+	}
+
+	virtual ~Spoiler() {};
+
+	inline double Time () const {
+		return this->_tpois.front();
+	}
+
+	/**
+	 * @brief Time of repetition k
+	 */
+	inline double Time (const size_t k) const {
+		return this->_tpois.front() + k * _period;
+	}
+
+	inline T Residual () const {
+		return _residual;
+	}
+
+	inline double Period () const {
+		return _period;
+	}
+
+	inline size_t Count () const {
+		return _count;
+	}
+
+	/**
+	 * @brief Time of the first repetition after t (infinity: none)
+	 */
+	inline double Next (const double t) const {
+		const double t0 = this->_tpois.front();
+		if (t < t0)
+			return t0;
+		if (_count == 1)
+			return std::numeric_limits<double>::infinity();
+		size_t k = (size_t) ((t - t0) / _period);
+		if (k > 0 && t0 + k * _period > t) // Rounding
+			--k;
+		while (t0 + k * _period <= t)
+			++k;
+		return (k < _count) ? t0 + k * _period : std::numeric_limits<double>::infinity();
+	}
+
+	/**
+	 * @brief Hash of time and residual
+	 */
+	uint64_t Hash () const {
+		uint64_t h = fnv1a (&_residual, sizeof(_residual), Event<T>::Hash());
+		h = fnv1a (&_period, sizeof(_period), h);
+		return fnv1a (&_count, sizeof(_count), h);
+	}
+
+	/**
+	 * @brief Hash of a single repetition: residual
+	 */
+	uint64_t HashRepetition () const {
+		return fnv1a (&_residual, sizeof(_residual));
+	}
+
+	template<class State> inline void Apply (State& m) const {
+		m[0] *= _residual;
+		m[1] *= _residual;
+	}
+
+	inline bool operator< (const Spoiler& s) const {
+		return Time() < s.Time();
+	}
+
+private:
+
+	T _residual;
+	double _period;
+	size_t _count;
+
+};
+
+#endif /* SPOILER_HPP_ */
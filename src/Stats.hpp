@@ -0,0 +1,388 @@
+/*
+ * Stats.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef STATS_HPP_
+#define STATS_HPP_
+
+#ifdef HAVE_CONFIG_H
+#    include "config.h"
+#endif
+
+#include "Timer.hpp"
+#include "NDData.hpp"
+
+#include <boost/numeric/odeint/stepper/controlled_runge_kutta.hpp>
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#    include <mutex>
+#elif defined (_OPENMP)
+#    include <omp.h>
+#endif
+
+/**
+ * @brief Hot path counters
+ */
+enum StatCounter {
+	RHS_CALLS,      /**< @brief RHS evaluations */
+	JACOBIAN_CALLS, /**< @brief Jacobian evaluations (implicit steppers) */
+	EPG_STATES,     /**< @brief Configuration state updates (EPG) */
+	STEPS_ACCEPTED, /**< @brief Accepted steps */
+	STEPS_REJECTED, /**< @brief Rejected steps */
+	RF_CALLS,       /**< @brief RF event evaluations */
+	RECORDER_CALLS, /**< @brief Observer calls of recorders */
+	BYTES_WRITTEN,  /**< @brief Bytes written to HDF5 */
+	SPINS,          /**< @brief Spins simulated */
+	SPIN_NS,        /**< @brief Wall time spent in spin simulation */
+	N_COUNTERS
+};
+
+static const char* StatCounterName[N_COUNTERS] = {
+	"rhs_calls", "jacobian_calls", "epg_states", "steps_accepted", "steps_rejected", "rf_calls",
+	"recorder_calls", "bytes_written", "spins", "spin_ns"
+};
+
+/**
+ * @brief Run statistics of one thread. Padded to keep threads off each
+ *        other's cache lines.
+ */
+struct ThreadStats {
+
+	ThreadStats () :
+		dt_min(std::numeric_limits<double>::max()), dt_max(0.) {
+		for (size_t i = 0; i < N_COUNTERS; ++i)
+			c[i] = 0;
+	}
+
+	inline void Step (const double dt, const bool accepted) {
+		if (accepted) {
+			++c[STEPS_ACCEPTED];
+			dt_min = std::min(dt_min, dt);
+			dt_max = std::max(dt_max, dt);
+		} else {
+			++c[STEPS_REJECTED];
+		}
+	}
+
+	inline void Event (const size_t e, const uint64_t ns) {
+		if (e >= event_ns.size()) {
+			event_ns.resize(e+1, 0);
+			event_calls.resize(e+1, 0);
+		}
+		event_ns[e] += ns;
+		++event_calls[e];
+	}
+
+	uint64_t c[N_COUNTERS];
+	double   dt_min, dt_max;
+	std::vector<uint64_t> event_ns;    /**< @brief Time in event evaluation */
+	std::vector<uint64_t> event_calls; /**< @brief Evaluations per event */
+	char     pad[64];
+
+};
+
+
+/**
+ * @brief Run-time switch of Stats: a plain static, so that Stats::On() on
+ *        the hot path is a load rather than a guarded singleton access. Set
+ *        from ODEINT_BLOCH_STATS before main.
+ */
+template<class T = void> struct StatsSwitch {
+	static bool on;
+	static bool FromEnv () {
+		const char* env = getenv("ODEINT_BLOCH_STATS");
+		return env && atoi(env) != 0;
+	}
+};
+template<class T> bool StatsSwitch<T>::on = StatsSwitch<T>::FromEnv();
+
+
+/**
+ * @brief Run statistics. Compiled in with configure --enable-stats, switched
+ *        on at run time with Stats::Instance().Enable() or by setting
+ *        ODEINT_BLOCH_STATS=1 in the environment. A summary is printed to
+ *        stderr at exit. Threads count in slots of their own; reading
+ *        and taking slots are serialised.
+ */
+class Stats {
+
+public:
+
+	static const size_t MAX_THREADS = 256; /**< @brief Slots before C++11 */
+
+	static Stats& Instance () {
+		static Stats stats;
+		return stats;
+	}
+
+	/**
+	 * @brief Calling thread's statistics. Since C++11 a slot of its own,
+	 *        taken on first use by any thread (OpenMP or std::thread) and
+	 *        handed on when the thread ends, its counts kept. Before, the
+	 *        slot of the OpenMP thread number.
+	 */
+	inline static ThreadStats& Local () {
+#if __cplusplus >= 201103L
+		static thread_local Slot slot;
+		return *slot.stats;
+#elif defined (_OPENMP)
+		return Instance()._threads[omp_get_thread_num() % MAX_THREADS];
+#else
+		return Instance()._threads[0];
+#endif
+	}
+
+	inline static bool On () { return StatsSwitch<>::on; }
+
+	inline void Enable (const bool on = true) { StatsSwitch<>::on = on; }
+
+	/**
+	 * @brief Reset all counters
+	 */
+	void Reset () {
+#if __cplusplus >= 201103L
+		std::lock_guard<std::mutex> lock (_mutex);
+#endif
+		for (size_t i = 0; i < _threads.size(); ++i)
+			_threads[i] = ThreadStats();
+		_start = wtime_ns();
+	}
+
+	/**
+	 * @brief Counter summed over threads
+	 */
+	uint64_t Total (const StatCounter c) const {
+#if __cplusplus >= 201103L
+		std::lock_guard<std::mutex> lock (_mutex);
+#endif
+		return Sum (c);
+	}
+
+	/**
+	 * @brief Print summary
+	 */
+	std::ostream& Print (std::ostream& os) const {
+#if __cplusplus >= 201103L
+		std::lock_guard<std::mutex> lock (_mutex);
+#endif
+		double dt_min = std::numeric_limits<double>::max(), dt_max = 0.;
+		size_t n_events = 0;
+		for (size_t i = 0; i < _threads.size(); ++i) {
+			dt_min = std::min(dt_min, _threads[i].dt_min);
+			dt_max = std::max(dt_max, _threads[i].dt_max);
+			n_events = std::max(n_events, _threads[i].event_ns.size());
+		}
+		os << "Run statistics (" << 1.e-9*(wtime_ns()-_start) << "s)" << std::endl;
+		for (size_t c = 0; c < N_COUNTERS; ++c)
+			os << "  " << std::setw(16) << std::left << StatCounterName[c]
+			   << std::right << std::setw(16) << Sum((StatCounter)c) << std::endl;
+		if (dt_max > 0.)
+			os << "  " << std::setw(16) << std::left << "dt [min,max]" << std::right
+			   << "[" << dt_min << ", " << dt_max << "]" << std::endl;
+		for (size_t e = 0; e < n_events; ++e) {
+			uint64_t ns = 0, calls = 0;
+			for (size_t i = 0; i < _threads.size(); ++i)
+				if (e < _threads[i].event_ns.size()) {
+					ns    += _threads[i].event_ns[e];
+					calls += _threads[i].event_calls[e];
+				}
+			os << "  event " << std::setw(10) << std::left << e << std::right
+			   << std::setw(16) << calls << " calls " << 1.e-9*ns << "s" << std::endl;
+		}
+		for (size_t i = 0; i < _threads.size(); ++i)
+			if (_threads[i].c[SPINS])
+				os << "  thread " << std::setw(9) << std::left << i << std::right
+				   << std::setw(16) << _threads[i].c[SPINS] << " spins "
+				   << 1.e9*_threads[i].c[SPINS]/std::max(_threads[i].c[SPIN_NS],(uint64_t)1)
+				   << " spins/s" << std::endl;
+		return os;
+	}
+
+	/**
+	 * @brief Write to HDF5 group (counters per thread, dt range, events)
+	 *
+	 * @param f    Open HDF5File
+	 * @param url  Group
+	 */
+	template<class F> void Write (F& f, const std::string& url = "/stats") const {
+#if __cplusplus >= 201103L
+		std::lock_guard<std::mutex> lock (_mutex);
+#endif
+		size_t nt = 1;
+		for (size_t i = 0; i < _threads.size(); ++i)
+			if (_threads[i].c[RHS_CALLS] || _threads[i].c[SPINS])
+				nt = i+1;
+		NDData<double> counters (N_COUNTERS, nt), dt (2);
+		dt[0] = std::numeric_limits<double>::max(); dt[1] = 0.;
+		size_t n_events = 0;
+		for (size_t i = 0; i < nt; ++i) {
+			for (size_t c = 0; c < N_COUNTERS; ++c)
+				counters(c,i) = _threads[i].c[c];
+			dt[0] = std::min(dt[0], _threads[i].dt_min);
+			dt[1] = std::max(dt[1], _threads[i].dt_max);
+			n_events = std::max(n_events, _threads[i].event_ns.size());
+		}
+		f.Write (counters, "counters", url);
+		f.Write (dt, "dt", url);
+		if (n_events) {
+			NDData<double> ev (2, n_events);
+			for (size_t i = 0; i < nt; ++i)
+				for (size_t e = 0; e < _threads[i].event_ns.size(); ++e) {
+					ev(0,e) += _threads[i].event_calls[e];
+					ev(1,e) += 1.e-9*_threads[i].event_ns[e];
+				}
+			f.Write (ev, "events", url);
+		}
+	}
+
+	~Stats () {
+		if (On() && (Total(RHS_CALLS) || Total(SPINS)))
+			Print (std::cerr);
+	}
+
+private:
+
+	Stats () : _start(wtime_ns()) {
+#if __cplusplus < 201103L
+		_threads.resize(MAX_THREADS);
+#endif
+	}
+
+	Stats (const Stats&);
+	Stats& operator= (const Stats&);
+
+	uint64_t Sum (const StatCounter c) const {
+		uint64_t s = 0;
+		for (size_t i = 0; i < _threads.size(); ++i)
+			s += _threads[i].c[c];
+		return s;
+	}
+
+#if __cplusplus >= 201103L
+	/** Slot of a thread, free slots are reused before new ones are added **/
+	struct Slot {
+		Slot () : stats(Instance().Acquire()) {}
+		~Slot () { Instance().Release (stats); }
+		ThreadStats* stats;
+	};
+
+	ThreadStats* Acquire () {
+		std::lock_guard<std::mutex> lock (_mutex);
+		if (!_free.empty()) {
+			ThreadStats* s = _free.back();
+			_free.pop_back();
+			return s;
+		}
+		_threads.push_back (ThreadStats()); // deque: slots stay put
+		return &_threads.back();
+	}
+
+	void Release (ThreadStats* s) {
+		std::lock_guard<std::mutex> lock (_mutex);
+		_free.push_back (s);
+	}
+
+	mutable std::mutex _mutex;
+	std::vector<ThreadStats*> _free;
+#endif
+
+	uint64_t _start;
+	std::deque<ThreadStats> _threads;
+
+};
+
+
+/**
+ * @brief Stop watch of the STATS_ macros: reads the clock only while
+ *        statistics are on, Lap() is 0 if it was started with them off
+ */
+class StatsTimer {
+
+public:
+
+	StatsTimer () : _start(Stats::On() ? wtime_ns() : 0) {}
+
+	inline uint64_t Lap () const { return _start ? wtime_ns() - _start : 0; }
+
+private:
+
+	uint64_t _start;
+
+};
+
+
+#ifdef WITH_STATS
+#    define STATS_INC(C)     do { if (Stats::On()) ++Stats::Local().c[C]; } while (0)
+#    define STATS_ADD(C,N)   do { if (Stats::On()) Stats::Local().c[C] += (N); } while (0)
+#    define STATS_TIMER(T)   StatsTimer T
+#    define STATS_EVENT(E,T) do { if (Stats::On()) Stats::Local().Event(E, T.Lap()); } while (0)
+#else
+#    define STATS_INC(C)     do {} while (0)
+#    define STATS_ADD(C,N)   do {} while (0)
+#    define STATS_TIMER(T)
+#    define STATS_EVENT(E,T) do {} while (0)
+#endif
+
+
+/**
+ * @brief Error checker of controlled steppers counting accepted and rejected
+ *        steps and the accepted step size range. Same error norm as odeint's
+ *        default_error_checker.
+ */
+template<class Value, class Algebra, class Operations>
+class counting_error_checker :
+	public boost::numeric::odeint::default_error_checker<Value, Algebra, Operations> {
+
+	typedef boost::numeric::odeint::default_error_checker<Value, Algebra, Operations> base;
+
+public:
+
+	counting_error_checker (Value eps_abs = static_cast<Value>(1.0e-6),
+			Value eps_rel = static_cast<Value>(1.0e-6),
+			Value a_x = static_cast<Value>(1), Value a_dxdt = static_cast<Value>(1)) :
+		base (eps_abs, eps_rel, a_x, a_dxdt) {}
+
+	template<class State, class Deriv, class Err, class Time> Value
+	error (const State& x_old, const Deriv& dxdt_old, Err& x_err, Time dt) const {
+		Algebra algebra;
+		return error (algebra, x_old, dxdt_old, x_err, dt);
+	}
+
+	template<class State, class Deriv, class Err, class Time> Value
+	error (Algebra& algebra, const State& x_old, const Deriv& dxdt_old, Err& x_err,
+			Time dt) const {
+		Value err = base::error (algebra, x_old, dxdt_old, x_err, dt);
+		if (Stats::On())
+			Stats::Local().Step (dt, err <= 1.);
+		return err;
+	}
+
+};
+
+
+/**
+ * @brief Error checker to use in controlled steppers: counting with stats
+ *        compiled in, odeint's default otherwise
+ */
+template<class Stepper> struct error_checker {
+#ifdef WITH_STATS
+	typedef counting_error_checker<typename Stepper::value_type,
+			typename Stepper::algebra_type, typename Stepper::operations_type> type;
+#else
+	typedef boost::numeric::odeint::default_error_checker<typename Stepper::value_type,
+			typename Stepper::algebra_type, typename Stepper::operations_type> type;
+#endif
+};
+
+#endif /* STATS_HPP_ */
@@ -0,0 +1,484 @@
+/*
+ * Stepper.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef STEPPER_HPP_
+#define STEPPER_HPP_
+
+#include "Bloch.hpp"
+#include "Splitting.hpp"
+#include "Stats.hpp"
+
+#include <boost/numeric/odeint.hpp>
+#include <boost/core/ref.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
+/**
+ * @brief Default stepper: odeint's integrate() choice (controlled dopri5,
+ *        abs/rel tolerance 1e-6) with step statistics if compiled in
+ */
+typedef boost::numeric::odeint::runge_kutta_dopri5<state_type> dopri5_type;
+typedef boost::numeric::odeint::controlled_runge_kutta<dopri5_type,
+		error_checker<dopri5_type>::type> default_stepper_type;
+
+/**
+ * @brief Stepper families
+ */
+enum StepperType {
+	EULER,       /**< @brief Explicit Euler (fixed) */
+	RK4,         /**< @brief Classic Runge-Kutta 4 (fixed) */
+	CASH_KARP54, /**< @brief Cash-Karp 5(4) (fixed, controlled) */
+	DOPRI5,      /**< @brief Dormand-Prince 5(4) (fixed, controlled, dense) */
+	FEHLBERG78,  /**< @brief Fehlberg 7(8) (fixed, controlled) */
+	ROSENBROCK4, /**< @brief Rosenbrock 4, implicit with analytic Jacobian
+	                         (fixed, controlled, dense) */
+	SPLITTING,   /**< @brief Relaxation / midpoint rotation splitting (fixed) */
+	MAGNUS4,     /**< @brief Relaxation / Magnus 4 rotation splitting (fixed) */
+	N_STEPPERS
+};
+
+static const char* StepperName[N_STEPPERS] = {
+	"euler", "rk4", "cash_karp54", "dopri5", "fehlberg78", "rosenbrock4",
+	"splitting", "magnus4"
+};
+
+/**
+ * @brief Step size control
+ */
+enum StepperMode {
+	FIXED,      /**< @brief Constant step dt */
+	CONTROLLED, /**< @brief Adaptive step, error controlled */
+	DENSE,      /**< @brief Adaptive step with dense output */
+	N_MODES
+};
+
+static const char* StepperModeName[N_MODES] = {
+	"fixed", "controlled", "dense"
+};
+
+/**
+ * @brief Frame the equations are integrated in
+ */
+enum Frame {
+	RF_FRAME,   /**< @brief Rotating at the RF carrier, spins precess at cs */
+	SPIN_FRAME, /**< @brief Rotating at each spin's cs (interaction picture):
+	                        free precession leaves nothing to resolve */
+	N_FRAMES
+};
+
+static const char* FrameName[N_FRAMES] = {
+	"rf", "spin"
+};
+
+
+/**
+ * @brief Stepper configuration. Defaults reproduce odeint's integrate().
+ *        Settable by key=value pairs from the command line or a config file:
+ *
+ *        stepper = euler|rk4|cash_karp54|dopri5|fehlberg78|rosenbrock4|
+ *                  splitting|magnus4
+ *        mode    = fixed|controlled|dense
+ *        abs_tol = 1e-6
+ *        rel_tol = 1e-6
+ *        dt      = 1e-8  (step for fixed, initial step otherwise)
+ *        frame   = rf|spin
+ */
+struct StepperConfig {
+
+	StepperConfig () : type(DOPRI5), mode(CONTROLLED), abs_tol(1.e-6), rel_tol(1.e-6),
+		dt(1.e-8), frame(RF_FRAME) {}
+
+	/**
+	 * @brief Set one parameter
+	 *
+	 * @param key    Parameter
+	 * @param value  Value
+	 * @return       Success
+	 */
+	bool Set (const std::string& key, const std::string& value) {
+		if (key == "stepper") {
+			for (size_t i = 0; i < N_STEPPERS; ++i)
+				if (value == StepperName[i]) {
+					type = (StepperType)i;
+					return true;
+				}
+		} else if (key == "mode") {
+			for (size_t i = 0; i < N_MODES; ++i)
+				if (value == StepperModeName[i]) {
+					mode = (StepperMode)i;
+					return true;
+				}
+		} else if (key == "abs_tol") {
+			return ToDouble (value, abs_tol);
+		} else if (key == "rel_tol") {
+			return ToDouble (value, rel_tol);
+		} else if (key == "dt") {
+			return ToDouble (value, dt);
+		} else if (key == "frame") {
+			for (size_t i = 0; i < N_FRAMES; ++i)
+				if (value == FrameName[i]) {
+					frame = (Frame)i;
+					return true;
+				}
+		}
+		std::cerr << "Invalid stepper setting " << key << " = " << value << std::endl;
+		return false;
+	}
+
+	/**
+	 * @brief Set from "key=value"
+	 */
+	bool Parse (const std::string& kv) {
+		size_t eq = kv.find('=');
+		if (eq == std::string::npos) {
+			std::cerr << "Expected key=value, got " << kv << std::endl;
+			return false;
+		}
+		return Set (Trim(kv.substr(0, eq)), Trim(kv.substr(eq+1)));
+	}
+
+	/**
+	 * @brief Read key = value lines, # starts a comment
+	 *
+	 * @param fname  Config file
+	 * @return       Success
+	 */
+	bool Read (const std::string& fname) {
+		std::ifstream ifs (fname.c_str());
+		if (!ifs) {
+			std::cerr << "Cannot open " << fname << std::endl;
+			return false;
+		}
+		std::string line;
+		while (std::getline (ifs, line)) {
+			line = Trim (line.substr(0, line.find('#')));
+			if (!line.empty() && !Parse (line))
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Stepper supports mode and parameters are sane
+	 */
+	bool Valid () const {
+		if (abs_tol <= 0. || rel_tol < 0. || dt <= 0.)
+			return false;
+		if (type == SPLITTING || type == MAGNUS4)
+			return (mode == FIXED);
+		switch (mode) {
+		case FIXED:      return true;
+		case CONTROLLED: return (type != EULER && type != RK4);
+		case DENSE:      return (type == DOPRI5 || type == ROSENBROCK4);
+		default:         return false;
+		}
+	}
+
+	std::ostream& Print (std::ostream& os) const {
+		return os << StepperName[type] << " (" << StepperModeName[mode] << ", abs_tol "
+				  << abs_tol << ", rel_tol " << rel_tol << ", dt " << dt << ", "
+				  << FrameName[frame] << " frame)";
+	}
+
+	StepperType type;
+	StepperMode mode;
+	double abs_tol;
+	double rel_tol;
+	double dt;
+	Frame frame;
+
+private:
+
+	static std::string Trim (const std::string& s) {
+		size_t b = s.find_first_not_of(" \t\r\n"), e = s.find_last_not_of(" \t\r\n");
+		return (b == std::string::npos) ? std::string() : s.substr(b, e-b+1);
+	}
+
+	static bool ToDouble (const std::string& s, double& d) {
+		char* end;
+		d = strtod (s.c_str(), &end);
+		return (end != s.c_str() && *end == '\0');
+	}
+
+};
+
+inline static std::ostream&
+operator<< (std::ostream& os, const StepperConfig& c) {
+	return c.Print(os);
+}
+
+
+/**
+ * @brief State, system and Jacobian of rosenbrock4 (ublas)
+ */
+typedef boost::numeric::ublas::vector<double> implicit_state_type;
+typedef boost::numeric::ublas::matrix<double> implicit_matrix_type;
+
+template<class T> struct bloch_implicit_system {
+	bool spin_frame;
+	bloch_implicit_system (const bool s = false) : spin_frame(s) {}
+	inline void operator() (const implicit_state_type& x, implicit_state_type& dxdt,
+			const double t) const {
+		state_type m = {{ x(0), x(1), x(2) }}, dm;
+		if (spin_frame)
+			bloch_spin_frame<T> (m, dm, t);
+		else
+			bloch<T> (m, dm, t);
+		dxdt(0) = dm[0]; dxdt(1) = dm[1]; dxdt(2) = dm[2];
+	}
+};
+
+template<class T> struct bloch_implicit_jacobian {
+	bool spin_frame;
+	bloch_implicit_jacobian (const bool s = false) : spin_frame(s) {}
+	inline void operator() (const implicit_state_type& x, implicit_matrix_type& J,
+			const double& t, implicit_state_type& dfdt) const {
+		state_type m = {{ x(0), x(1), x(2) }}, dm;
+		boost::array<T,9> B;
+		if (spin_frame)
+			bloch_jacobian_spin_frame<T> (m, B, t, dm);
+		else
+			bloch_jacobian<T> (m, B, t, dm);
+		for (size_t i = 0; i < 3; ++i) {
+			for (size_t j = 0; j < 3; ++j)
+				J(i,j) = B[i+3*j];
+			dfdt(i) = dm[i];
+		}
+	}
+};
+
+/**
+ * @brief Observer adaptor: Pass ublas state to an observer of state_type
+ */
+template<class Observer> struct implicit_observer {
+	Observer obs;
+	implicit_observer (Observer o) : obs(o) {}
+	inline void operator() (const implicit_state_type& x, const double t) {
+		state_type m = {{ x(0), x(1), x(2) }};
+		boost::unwrap_ref(obs) (m, t);
+	}
+};
+
+/**
+ * @brief Observer adaptor: Map spin frame states back to the RF frame
+ */
+template<class Observer> struct spin_frame_observer {
+	Observer obs;
+	double cs;
+	spin_frame_observer (Observer o, const double c) : obs(o), cs(c) {}
+	inline void operator() (const state_type& m, const double t) {
+		state_type x = m;
+		rotate_z (x, -cs*t);
+		boost::unwrap_ref(obs) (x, t);
+	}
+};
+
+
+/**
+ * @brief Integrate any system with an explicit stepper (all but rosenbrock4
+ *        and the Bloch specific splitting steppers)
+ *        from t0 to t1. The stepper is chosen here, once per integration;
+ *        steppers are constructed fresh.
+ *
+ * @param c    Stepper configuration
+ * @param sys  odeint system sys(x, dxdt, t)
+ * @param x    State (in: initial, out: final)
+ * @param t0   Start time
+ * @param t1   End time
+ * @param obs  Observer (called with (x,t) after every step)
+ * @return     Number of steps
+ */
+template<class State, class System, class Observer> size_t
+IntegrateExplicit (const StepperConfig& c, System sys, State& x, const double t0,
+		const double t1, Observer obs) {
+
+	using namespace boost::numeric::odeint;
+	typedef runge_kutta_cash_karp54<State> cash_karp54_type;
+	typedef runge_kutta_dopri5<State>      dopri5_state_type;
+	typedef runge_kutta_fehlberg78<State>  fehlberg78_type;
+
+	assert (c.Valid() && c.type != ROSENBROCK4 && c.type != SPLITTING && c.type != MAGNUS4);
+
+	switch (c.mode) {
+	case FIXED:
+		switch (c.type) {
+		case EULER:
+			return integrate_const (euler<State>(), sys, x, t0, t1, c.dt, obs);
+		case RK4:
+			return integrate_const (runge_kutta4<State>(), sys, x, t0, t1, c.dt, obs);
+		case CASH_KARP54:
+			return integrate_const (cash_karp54_type(), sys, x, t0, t1, c.dt, obs);
+		case DOPRI5:
+			return integrate_const (dopri5_state_type(), sys, x, t0, t1, c.dt, obs);
+		default:
+			return integrate_const (fehlberg78_type(), sys, x, t0, t1, c.dt, obs);
+		}
+	case CONTROLLED:
+		switch (c.type) {
+		case CASH_KARP54:
+			return integrate_adaptive (controlled_runge_kutta<cash_karp54_type,
+					typename error_checker<cash_karp54_type>::type> (
+							typename error_checker<cash_karp54_type>::type (c.abs_tol, c.rel_tol)),
+					sys, x, t0, t1, c.dt, obs);
+		case DOPRI5:
+			return integrate_adaptive (controlled_runge_kutta<dopri5_state_type,
+					typename error_checker<dopri5_state_type>::type> (
+							typename error_checker<dopri5_state_type>::type (c.abs_tol, c.rel_tol)),
+					sys, x, t0, t1, c.dt, obs);
+		default:
+			return integrate_adaptive (controlled_runge_kutta<fehlberg78_type,
+					typename error_checker<fehlberg78_type>::type> (
+							typename error_checker<fehlberg78_type>::type (c.abs_tol, c.rel_tol)),
+					sys, x, t0, t1, c.dt, obs);
+		}
+	default:
+		return integrate_adaptive (make_dense_output (c.abs_tol, c.rel_tol, dopri5_state_type()),
+				sys, x, t0, t1, c.dt, obs);
+	}
+
+}
+
+
+/**
+ * @brief Integrate Bloch equations of the calling thread's environment
+ *        in the RF or spin frame from t0 to t1 with the configured
+ *        stepper, no spoilers. The stepper is chosen here, once per
+ *        integration; steppers are constructed fresh.
+ *
+ * @param c    Stepper configuration
+ * @param spin_frame  Integrate bloch_spin_frame() (m in that frame)
+ * @param m    Magnetisation (in: initial, out: final)
+ * @param t0   Start time
+ * @param t1   End time
+ * @param obs  Observer (called with (m,t) after every step)
+ * @return     Number of steps
+ */
+template<class T, class Observer> size_t
+IntegrateFrame (const StepperConfig& c, const bool spin_frame, state_type& m,
+		const double t0, const double t1, Observer obs) {
+
+	using namespace boost::numeric::odeint;
+	typedef rosenbrock4<double> rosenbrock4_type;
+
+	assert (c.Valid());
+
+	if (c.type == SPLITTING || c.type == MAGNUS4) {
+		void (*sys)(const state_type&, state_type&, double) = bloch<T>; // Not evaluated
+		return integrate_const (splitting_stepper<T> (
+				(c.type == MAGNUS4) ? MAGNUS4_SPLITTING : MIDPOINT_SPLITTING, spin_frame),
+				sys, m, t0, t1, c.dt, obs);
+	}
+
+	if (c.type == ROSENBROCK4) {
+		implicit_state_type x (3);
+		x(0) = m[0]; x(1) = m[1]; x(2) = m[2];
+		std::pair<bloch_implicit_system<T>, bloch_implicit_jacobian<T> > sys (
+				(bloch_implicit_system<T> (spin_frame)), bloch_implicit_jacobian<T> (spin_frame));
+		implicit_observer<Observer> iobs (obs);
+		size_t steps = 0;
+		switch (c.mode) {
+		case FIXED:
+			steps = integrate_const (rosenbrock4_type(), sys, x, t0, t1, c.dt, iobs); break;
+		case CONTROLLED:
+			steps = integrate_adaptive (make_controlled (c.abs_tol, c.rel_tol, rosenbrock4_type()),
+					sys, x, t0, t1, c.dt, iobs); break;
+		default:
+			steps = integrate_adaptive (make_dense_output (c.abs_tol, c.rel_tol, rosenbrock4_type()),
+					sys, x, t0, t1, c.dt, iobs); break;
+		}
+		m[0] = x(0); m[1] = x(1); m[2] = x(2);
+		return steps;
+	}
+
+	void (*sys)(const state_type&, state_type&, double) =
+			spin_frame ? bloch_spin_frame<T> : bloch<T>;
+	return IntegrateExplicit (c, sys, m, t0, t1, obs);
+
+}
+
+
+
+/**
+ * @brief Integrate Bloch equations of the calling thread's environment
+ *        from t0 to t1 with the configured stepper and frame, no spoilers.
+ *        In the spin frame, m is mapped there at t0 and back at t1, the
+ *        observer sees RF frame states.
+ *
+ * @param c    Stepper configuration
+ * @param m    Magnetisation (in: initial, out: final)
+ * @param t0   Start time
+ * @param t1   End time
+ * @param obs  Observer (called with (m,t) after every step)
+ * @return     Number of steps
+ */
+template<class T, class Observer> size_t
+IntegrateSegment (const StepperConfig& c, state_type& m, const double t0, const double t1,
+		Observer obs) {
+
+	if (c.frame != SPIN_FRAME)
+		return IntegrateFrame<T> (c, false, m, t0, t1, obs);
+
+	const double cs = Bloch<T>::Instance().GetSpin().cs();
+	rotate_z (m, cs*t0);
+	const size_t steps = IntegrateFrame<T> (c, true, m, t0, t1,
+			spin_frame_observer<Observer> (obs, cs));
+	rotate_z (m, -cs*t1);
+	return steps;
+
+}
+
+
+/**
+ * @brief Integrate Bloch equations of the calling thread's environment
+ *        from t0 to t1 with the configured stepper. Spoilers (and their
+ *        repetitions) at times in (t0, t1] split the integration: integrate
+ *        up to the spoiler, spoil, continue with a fresh stepper. The observer sees the state
+ *        before and after spoiling at the spoiler time.
+ *
+ * @param c    Stepper configuration
+ * @param m    Magnetisation (in: initial, out: final)
+ * @param t0   Start time
+ * @param t1   End time
+ * @param obs  Observer (called with (m,t) after every step)
+ * @return     Number of steps
+ */
+template<class T, class Observer> size_t
+Integrate (const StepperConfig& c, state_type& m, const double t0, const double t1,
+		Observer obs) {
+
+	const std::vector<const Spoiler<T>*>& spoilers = Bloch<T>::Instance().GetSpoilers();
+	if (spoilers.empty())
+		return IntegrateSegment<T> (c, m, t0, t1, obs);
+
+	size_t steps = 0, first = 0; // Spoilers before first are past
+	double t = t0;
+	while (true) {
+		while (first < spoilers.size() && spoilers[first]->Next(t) > t1)
+			++first;
+		double ts = std::numeric_limits<double>::infinity();
+		for (size_t i = first; i < spoilers.size() && spoilers[i]->Time() <= ts; ++i)
+			ts = std::min (ts, spoilers[i]->Next(t));
+		if (ts > t1)
+			break;
+		steps += IntegrateSegment<T> (c, m, t, ts, obs);
+		for (size_t i = first; i < spoilers.size() && spoilers[i]->Time() <= ts; ++i)
+			if (spoilers[i]->Next(t) == ts)
+				spoilers[i]->Apply (m);
+		t = ts;
+	}
+	if (t < t1)
+		steps += IntegrateSegment<T> (c, m, t, t1, obs);
+	return steps;
+
+}
+
+#endif /* STEPPER_HPP_ */
@@ -0,0 +1,523 @@
+/*
+ * Stream.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef STREAM_HPP_
+#define STREAM_HPP_
+
+#include "Bloch.hpp"
+#include "HDF5File.hpp"
+#include "Sample.hpp"
+#include "Stepper.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+/**
+ * @brief Magnetisation at an integration step or ADC sample
+ */
+struct TimedState {
+	double t;
+	state_type m;
+};
+
+
+/**
+ * @brief Pull range over the states of one spin: every step from t0 to t1
+ *        as an observer sees them (see Integrate()), or the ADC samples at
+ *        given times. A producer thread integrates on a copy of the
+ *        environment into a ring buffer of capacity states and waits while
+ *        it is full; the consumer pulls:
+ *
+ *        Stream<double> s (env, config, m0, t0, t1);
+ *        for (Stream<double>::iterator it = s.begin(); it != s.end(); ++it)
+ *            use (it->t, it->m);
+ *
+ *        Nothing is kept beyond the buffer. The threads wake each other
+ *        when the buffer is half full or half empty, not per state. A
+ *        stream destroyed before its end stops the integration. Events are
+ *        held by pointer (see Bloch::AddEvent()) and must outlive the
+ *        stream. C++11 only.
+ */
+template<class T> class Stream {
+
+public:
+
+	/**
+	 * @brief Single pass input iterator, pulling from the stream
+	 */
+	class iterator {
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef TimedState              value_type;
+		typedef std::ptrdiff_t          difference_type;
+		typedef const TimedState*       pointer;
+		typedef const TimedState&       reference;
+		iterator (Stream* s = 0) : _s(s) {
+			if (_s && !_s->Next (_state))
+				_s = 0;
+		}
+		inline reference operator* () const { return _state; }
+		inline pointer operator-> () const { return &_state; }
+		inline iterator& operator++ () {
+			if (!_s->Next (_state))
+				_s = 0;
+			return *this;
+		}
+		inline bool operator== (const iterator& it) const { return _s == it._s; }
+		inline bool operator!= (const iterator& it) const { return _s != it._s; }
+	private:
+		Stream* _s; // End: 0
+		TimedState _state;
+	};
+
+	/**
+	 * @brief Stream every step from t0 to t1
+	 *
+	 * @param env       Simulation environment (spin and events), copied
+	 * @param config    Stepper configuration
+	 * @param m0        Initial magnetisation
+	 * @param t0        Start time
+	 * @param t1        End time
+	 * @param capacity  Buffered states
+	 */
+	Stream (const Bloch<T>& env, const StepperConfig& config, const state_type& m0,
+			const double t0, const double t1, const size_t capacity = 1024) :
+		_env(env), _config(config), _m0(m0), _t0(t0), _t1(t1) {
+		Start (capacity);
+	}
+
+	/**
+	 * @brief Stream the states at ADC times, integrated from the first
+	 *        (state m0) sample to sample
+	 *
+	 * @param env       Simulation environment (spin and events), copied
+	 * @param config    Stepper configuration
+	 * @param m0        Magnetisation at times[0]
+	 * @param times     ADC times, ascending
+	 * @param capacity  Buffered states
+	 */
+	Stream (const Bloch<T>& env, const StepperConfig& config, const state_type& m0,
+			const std::vector<double>& times, const size_t capacity = 1024) :
+		_env(env), _config(config), _m0(m0), _t0(0.), _t1(0.), _times(times) {
+		Start (capacity);
+	}
+
+	~Stream () {
+		{
+			std::unique_lock<std::mutex> lock (_mutex);
+			_stop = true;
+		}
+		_not_full.notify_all();
+		_producer.join();
+	}
+
+	/**
+	 * @brief Next state, waits for the producer
+	 *
+	 * @param s  State
+	 * @return   False at the end
+	 */
+	bool Next (TimedState& s) {
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (_size == 0 && !_done)
+			_not_empty.wait (lock);
+		if (_size == 0)
+			return false;
+		s = _ring[_head];
+		_head = (_head + 1) % _ring.size();
+		if (--_size == _ring.size() - Half())
+			_not_full.notify_one();
+		return true;
+	}
+
+	inline iterator begin () { return iterator (this); }
+
+	inline iterator end () { return iterator (); }
+
+	/**
+	 * @brief Integration steps (complete at the end)
+	 */
+	inline size_t Steps () const { return _steps; }
+
+private:
+
+	Stream (const Stream&);
+	Stream& operator= (const Stream&);
+
+	/** Thrown by Push() to end a stopped integration **/
+	struct Stopped {};
+
+	/** Observer handing steps to the buffer **/
+	struct push_observer {
+		push_observer (Stream& s) : _s(s) {}
+		inline void operator() (const state_type& m, const double t) { _s.Push (m, t); }
+		Stream& _s;
+	};
+
+	void Start (const size_t capacity) {
+		_ring.resize (std::max (capacity, (size_t) 1));
+		_head = _size = _steps = 0;
+		_done = _stop = false;
+		_producer = std::thread (&Stream::Produce, this);
+	}
+
+	inline size_t Half () const { return (_ring.size() + 1) / 2; }
+
+	/** Append state, waits while the buffer is full **/
+	void Push (const state_type& m, const double t) {
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (_size == _ring.size() && !_stop)
+			_not_full.wait (lock);
+		if (_stop)
+			throw Stopped();
+		TimedState& s = _ring[(_head + _size) % _ring.size()];
+		s.t = t;
+		s.m = m;
+		if (++_size == Half())
+			_not_empty.notify_one();
+	}
+
+	/** Producer thread: integrate on a copy of the environment **/
+	void Produce () {
+		Bloch<T>::Instance() = _env;
+		state_type m = _m0;
+		size_t steps = 0;
+		try {
+			if (_times.empty()) {
+				steps = Integrate<T> (_config, m, _t0, _t1, push_observer (*this));
+			} else {
+				Push (m, _times[0]);
+				for (size_t k = 1; k < _times.size(); ++k) {
+					steps += Integrate<T> (_config, m, _times[k-1], _times[k],
+							boost::numeric::odeint::null_observer());
+					Push (m, _times[k]);
+				}
+			}
+		} catch (const Stopped&) {}
+		std::unique_lock<std::mutex> lock (_mutex);
+		_steps = steps;
+		_done = true;
+		_not_empty.notify_all();
+	}
+
+	Bloch<T> _env;
+	StepperConfig _config;
+	state_type _m0;
+	double _t0, _t1;
+	std::vector<double> _times;
+
+	std::vector<TimedState> _ring;
+	size_t _head, _size, _steps;
+	bool _done, _stop;
+	std::mutex _mutex;
+	std::condition_variable _not_empty, _not_full;
+	std::thread _producer;
+
+};
+
+
+/**
+ * @brief Writer thread filling chunked data sets "times" and "signal"
+ *        (complex) of n samples in group url block by block, at most depth
+ *        blocks waiting. The file is the writer's until Finish().
+ */
+class SignalWriter {
+
+	typedef std::complex<double> CT;
+
+public:
+
+	/**
+	 * @brief Create the data sets and start writing
+	 *
+	 * @param f      Open file
+	 * @param times  Sample times (n), kept by reference
+	 * @param url    Group
+	 * @param chunk  Samples per block (HDF5 chunk), all but the last block
+	 * @param depth  Blocks waiting at most
+	 */
+	SignalWriter (HDF5File& f, const std::vector<double>& times, const std::string& url,
+			const size_t chunk, const size_t depth) :
+		_f(f), _times(times), _url(url), _chunk(chunk), _depth(depth), _status(OK),
+		_closing(false) {
+		_writer = std::thread (&SignalWriter::Run, this);
+	}
+
+	~SignalWriter () {
+		Finish();
+	}
+
+	/**
+	 * @brief Queue the next block (swapped out), waits while depth blocks
+	 *        are queued
+	 *
+	 * @return  False if writing failed
+	 */
+	bool Put (std::vector<CT>& data) {
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (_queue.size() >= _depth && _status == OK)
+			_cv.wait (lock);
+		if (_status != OK)
+			return false;
+		_queue.push_back (std::vector<CT>());
+		_queue.back().swap (data);
+		_cv.notify_all();
+		return true;
+	}
+
+	/**
+	 * @brief Wait until the queued blocks are written
+	 */
+	IOStatus Finish () {
+		{
+			std::unique_lock<std::mutex> lock (_mutex);
+			_closing = true;
+		}
+		_cv.notify_all();
+		if (_writer.joinable())
+			_writer.join();
+		return _status;
+	}
+
+private:
+
+	SignalWriter (const SignalWriter&);
+	SignalWriter& operator= (const SignalWriter&);
+
+	void Fail (const IOStatus s) {
+		std::unique_lock<std::mutex> lock (_mutex);
+		_status = s;
+		_cv.notify_all();
+	}
+
+	void Run () {
+		const size_t n = _times.size();
+		IOStatus s;
+		if ((s = _f.Create<double> ("times", n, _url, _chunk)) != OK ||
+			(s = _f.Create<CT> ("signal", n, _url, _chunk)) != OK)
+			return Fail (s);
+		for (size_t i0 = 0; i0 < n; i0 += _chunk) {
+			std::vector<CT> data;
+			{
+				std::unique_lock<std::mutex> lock (_mutex);
+				while (_queue.empty() && !_closing)
+					_cv.wait (lock);
+				if (_queue.empty()) // Closed early
+					return;
+				data.swap (_queue.front());
+				_queue.pop_front();
+				_cv.notify_all();
+			}
+			if ((s = _f.WritePart (&_times[i0], i0, data.size(), "times", _url)) != OK ||
+				(s = _f.WritePart (&data[0], i0, data.size(), "signal", _url)) != OK)
+				return Fail (s);
+		}
+	}
+
+	HDF5File& _f;
+	const std::vector<double>& _times;
+	std::string _url;
+	size_t _chunk, _depth;
+	IOStatus _status;
+	bool _closing;
+	std::deque<std::vector<CT> > _queue;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _writer;
+
+};
+
+
+/**
+ * @brief Producer thread integrating a shard of the spins of a sample at
+ *        ADC times, block by block: every spin of the shard is integrated
+ *        through the block, sample to sample as Stream does, and its
+ *        transverse magnetisation added to the partial signal of the
+ *        block. Up to depth blocks wait for the consumer. A shard
+ *        destroyed before its end stops the integration.
+ */
+template<class T> class SignalShard {
+
+	typedef std::complex<double> CT;
+
+public:
+
+	/**
+	 * @brief Start integrating spins [first, last) of sample
+	 *
+	 * @param env     Simulation environment (events), copied
+	 * @param sample  Sample, kept by reference
+	 * @param first   First spin
+	 * @param last    Past the last spin
+	 * @param config  Stepper configuration
+	 * @param m0      Magnetisation at adc[0]
+	 * @param adc     ADC times, ascending, kept by reference
+	 * @param chunk   Samples per block
+	 * @param depth   Blocks waiting at most
+	 */
+	SignalShard (const Bloch<T>& env, const Sample<T>& sample, const size_t first,
+			const size_t last, const StepperConfig& config, const state_type& m0,
+			const std::vector<double>& adc, const size_t chunk, const size_t depth) :
+		_env(env), _sample(sample), _first(first), _last(last), _config(config), _m0(m0),
+		_adc(adc), _chunk(chunk), _depth(depth), _done(false), _stop(false) {
+		_producer = std::thread (&SignalShard::Produce, this);
+	}
+
+	~SignalShard () {
+		{
+			std::unique_lock<std::mutex> lock (_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		_producer.join();
+	}
+
+	/**
+	 * @brief Partial signal of the next block (swapped in), waits for the
+	 *        producer
+	 *
+	 * @return  False at the end
+	 */
+	bool Next (std::vector<CT>& block) {
+		std::unique_lock<std::mutex> lock (_mutex);
+		while (_queue.empty() && !_done)
+			_cv.wait (lock);
+		if (_queue.empty())
+			return false;
+		block.swap (_queue.front());
+		_queue.pop_front();
+		_cv.notify_all();
+		return true;
+	}
+
+private:
+
+	SignalShard (const SignalShard&);
+	SignalShard& operator= (const SignalShard&);
+
+	/** Producer thread: integrate on a copy of the environment **/
+	void Produce () {
+		Bloch<T>& local = Bloch<T>::Instance();
+		local = _env;
+		std::vector<state_type> m (_last - _first, _m0);
+		const size_t n = _adc.size();
+		for (size_t i0 = 0; i0 < n; i0 += _chunk) {
+			std::vector<CT> sum (std::min (_chunk, n - i0), CT (0., 0.));
+			for (size_t i = _first; i < _last; ++i) {
+				local.SetSpin (_sample[i]);
+				state_type& x = m[i - _first];
+				for (size_t j = 0, k = i0; j < sum.size(); ++j, ++k) {
+					if (k > 0)
+						Integrate<T> (_config, x, _adc[k-1], _adc[k],
+								boost::numeric::odeint::null_observer());
+					sum[j] += CT (x[0], x[1]);
+				}
+			}
+			std::unique_lock<std::mutex> lock (_mutex);
+			while (_queue.size() >= _depth && !_stop)
+				_cv.wait (lock);
+			if (_stop)
+				break;
+			_queue.push_back (std::vector<CT>());
+			_queue.back().swap (sum);
+			_cv.notify_all();
+		}
+		std::unique_lock<std::mutex> lock (_mutex);
+		_done = true;
+		_cv.notify_all();
+	}
+
+	Bloch<T> _env;
+	const Sample<T>& _sample;
+	size_t _first, _last;
+	StepperConfig _config;
+	state_type _m0;
+	const std::vector<double>& _adc;
+	size_t _chunk, _depth;
+
+	std::deque<std::vector<CT> > _queue;
+	bool _done, _stop;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _producer;
+
+};
+
+
+/**
+ * @brief Pipeline: simulate the spins of a sample at ADC times, split in
+ *        shards over a bounded number of threads (see SignalShard), sum
+ *        the shards' partial signals block by block and hand the blocks
+ *        to a SignalWriter. Simulation, accumulation and writing run
+ *        concurrently, threads scale with the cores, not the spins.
+ *        Memory: depth blocks per shard and depth blocks waiting to be
+ *        written, no trajectories. Same file layout as writing the whole
+ *        signal.
+ *
+ * @param f        Open file, the pipeline's until return
+ * @param sample   Sample
+ * @param env      Simulation environment (events)
+ * @param m0       Magnetisation at adc[0]
+ * @param adc      ADC times, ascending
+ * @param config   Stepper configuration
+ * @param url      Group
+ * @param block    Samples per block (HDF5 chunk and write size)
+ * @param threads  Producer threads at most (0: hardware concurrency)
+ * @param depth    Blocks waiting per shard and to be written at most
+ * @return         Status
+ */
+template<class T> IOStatus
+StreamSignal (HDF5File& f, const Sample<T>& sample, const Bloch<T>& env,
+		const state_type& m0, const std::vector<double>& adc,
+		const StepperConfig& config = StepperConfig(), const std::string& url = "/",
+		const size_t block = 4096, size_t threads = 0, const size_t depth = 4) {
+
+	typedef std::complex<double> CT;
+	assert (!adc.empty() && block > 0 && depth > 0);
+	const size_t n = adc.size(), chunk = std::min (block, n);
+	SignalWriter writer (f, adc, url, chunk, depth);
+
+	if (threads == 0)
+		threads = std::max (std::thread::hardware_concurrency(), 1u);
+	const size_t shards = std::min (threads, sample.Size());
+	std::vector<SignalShard<T>*> producers;
+	for (size_t s = 0; s < shards; ++s)
+		producers.push_back (new SignalShard<T> (env, sample, s * sample.Size() / shards,
+				(s+1) * sample.Size() / shards, config, m0, adc, chunk, depth));
+
+	std::vector<CT> part;
+	for (size_t i0 = 0; i0 < n; i0 += chunk) {
+		std::vector<CT> data (std::min (chunk, n - i0), CT (0., 0.));
+		for (size_t s = 0; s < producers.size(); ++s)
+			if (producers[s]->Next (part))
+				for (size_t j = 0; j < data.size(); ++j)
+					data[j] += part[j];
+		if (!writer.Put (data))
+			break;
+	}
+
+	for (size_t s = 0; s < producers.size(); ++s)
+		delete producers[s];
+	return writer.Finish();
+
+}
+
+#endif
+
+#endif /* STREAM_HPP_ */
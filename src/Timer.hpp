@@ -0,0 +1,95 @@
+/*
+ * Timer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef TIMER_HPP_
+#define TIMER_HPP_
+
+#ifdef HAVE_CONFIG_H
+#    include "config.h"
+#endif
+
+#if defined (HAVE_CLOCK_GETTIME)
+#    include <time.h>
+#elif defined (HAVE_MACH_ABSOLUTE_TIME)
+#    include <mach/mach_time.h>
+#elif defined (HAVE_GETHRTIME)
+#    include <sys/time.h>
+#else
+#    include <sys/time.h>
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief  Monotonic wall clock in nanoseconds, using the best clock
+ *         configure found (clock_gettime, mach_absolute_time, gethrtime,
+ *         gettimeofday in that order).
+ */
+inline static uint64_t
+wtime_ns () {
+#if defined (HAVE_CLOCK_GETTIME)
+	timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#elif defined (HAVE_MACH_ABSOLUTE_TIME)
+	static mach_timebase_info_data_t tb;
+	if (tb.denom == 0)
+		mach_timebase_info (&tb);
+	return mach_absolute_time() * tb.numer / tb.denom;
+#elif defined (HAVE_GETHRTIME)
+	return (uint64_t) gethrtime();
+#else
+	timeval tv;
+	gettimeofday (&tv, 0);
+	return (uint64_t)tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif
+}
+
+/**
+ * @brief  Wall clock in seconds
+ */
+inline static double
+wtime () {
+	return 1.e-9 * wtime_ns();
+}
+
+/**
+ * @brief  Simple stop watch
+ */
+class Timer {
+
+public:
+
+	Timer () : _start(wtime_ns()), _elapsed(0) {}
+
+	inline void Start () { _start = wtime_ns(); }
+
+	inline uint64_t Stop () {
+		_elapsed += wtime_ns() - _start;
+		return _elapsed;
+	}
+
+	inline void Reset () { _elapsed = 0; _start = wtime_ns(); }
+
+	/**
+	 * @brief Accumulated nanoseconds between Start and Stop
+	 */
+	inline uint64_t Elapsed () const { return _elapsed; }
+
+	/**
+	 * @brief Nanoseconds since last Start
+	 */
+	inline uint64_t Lap () const { return wtime_ns() - _start; }
+
+private:
+
+	uint64_t _start;
+	uint64_t _elapsed;
+
+};
+
+#endif /* TIMER_HPP_ */
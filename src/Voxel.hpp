@@ -0,0 +1,222 @@
+/*
+ * Voxel.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: kvahed
+ */
+
+#ifndef VOXEL_HPP_
+#define VOXEL_HPP_
+
+#include "Bloch.hpp"
+#include "Sample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+enum Spread {
+	LORENTZIAN_SPREAD, /**< @brief Lorentzian, width is the FWHM (T2' = 1/(pi width)) */
+	UNIFORM_SPREAD     /**< @brief Uniform, width is the full width */
+};
+
+/**
+ * @brief Voxel: a spin whose off-resonance spreads around cs() with a
+ *        Lorentzian or uniform distribution (intra-voxel B0 inhomogeneity,
+ *        T2*). Free precession of the voxel signal is the spin's, times the
+ *        characteristic function of the spread, so needs no isochromats:
+ *
+ *        - Lorentzian: exp(-pi width t)
+ *        - Uniform:    sinc(pi width t)
+ *
+ *        Where isochromats are needed (RF, Bloch<T> ODE), Isochromats()
+ *        samples the spread (Quadrature()) and Resolution() finds the
+ *        fewest that reproduce the free precession to a tolerance.
+ */
+template<class T> class Voxel {
+
+public:
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param spin    Spin (cs: centre of the spread)
+	 * @param spread  Distribution
+	 * @param width   Width [Hz]
+	 */
+	Voxel (const Spin<T>& spin = Spin<T>(), const Spread spread = LORENTZIAN_SPREAD,
+			const T width = 0.) : _spin(spin), _spread(spread), _width(width) {}
+
+	inline const Spin<T>& GetSpin () const { return _spin; }
+	inline Spread GetSpread () const { return _spread; }
+	inline T Width () const { return _width; }
+
+	/**
+	 * @brief Transverse signal fraction left after t of free precession
+	 *        from in phase by the spread alone (characteristic function)
+	 */
+	inline double Dephasing (const double t) const {
+		const double x = .5 * TWOPI * _width * std::fabs(t);
+		if (_spread == LORENTZIAN_SPREAD)
+			return std::exp(-x);
+		return (x < 1.e-8) ? 1. : std::sin(x)/x;
+	}
+
+	/**
+	 * @brief Voxel magnetisation after free precession for t, relaxation
+	 *        included, from m with all isochromats in phase
+	 *
+	 * @param m  Magnetisation at in phase
+	 * @param t  Time since
+	 * @return   Magnetisation
+	 */
+	state_type FID (const state_type& m, const double t) const {
+		const double e1 = std::exp(-t/_spin.t1()),
+				e2 = std::exp(-t/_spin.t2()) * Dephasing(t),
+				c = std::cos(_spin.cs()*t), s = std::sin(_spin.cs()*t);
+		state_type ret = {{ e2 * ( c*m[0] + s*m[1]), e2 * (-s*m[0] + c*m[1]),
+				e1*m[2] + _spin.pd()*(1.-e1) }};
+		return ret;
+	}
+
+	/**
+	 * @brief Quadrature of the spread by n isochromats, for free
+	 *        precession up to tmax
+	 *
+	 *        - Uniform: midpoints of n equal bins, equal weights
+	 *        - Lorentzian: points spaced 2 pi/(2 tmax + 10 T2') around cs,
+	 *          the density as weight (the sum of the isochromats is periodic
+	 *          in time, aliasing is below exp(-10)). The tails beyond the
+	 *          outermost points are dropped.
+	 *
+	 * @param n        Number of isochromats
+	 * @param tmax     Longest free precession
+	 * @param offsets  Off-resonance [rad/s]
+	 * @param weights  Fractions of M0
+	 */
+	void Quadrature (const size_t n, const double tmax, std::vector<T>& offsets,
+			std::vector<T>& weights) const {
+		offsets.resize (n);
+		weights.resize (n);
+		const double hw = .5 * TWOPI * _width; // Lorentzian HWHM, 1/T2' [rad/s]
+		const double d = (_spread == LORENTZIAN_SPREAD) ?
+				TWOPI / (2.*tmax + 10./hw) : TWOPI * _width / n;
+		for (size_t j = 0; j < n; ++j) {
+			const double w = d * (j - .5*(n-1));
+			offsets[j] = _spin.cs() + w;
+			weights[j] = (_spread == LORENTZIAN_SPREAD) ?
+					d * hw / (.5*TWOPI * (hw*hw + w*w)) : 1./n;
+		}
+	}
+
+	/**
+	 * @brief n isochromats (Quadrature()) with the voxel's M0, the voxel
+	 *        is their weighted sum
+	 *
+	 * @param n        Number of isochromats
+	 * @param tmax     Longest free precession
+	 * @param weights  Weights
+	 * @return         Isochromats
+	 */
+	Sample<T> Isochromats (const size_t n, const double tmax, std::vector<T>& weights) const {
+		Sample<T> ret;
+		std::vector<T> offsets;
+		Quadrature (n, tmax, offsets, weights);
+		for (size_t j = 0; j < n; ++j)
+			ret.PushBack (Spin<T> (_spin.pd(), _spin.rx(), _spin.ry(), _spin.rz(),
+					_spin.t1(), _spin.t2(), offsets[j]));
+		return ret;
+	}
+
+	/**
+	 * @brief Largest deviation of the free precession of n isochromats
+	 *        from the voxel's at the given times (ascending)
+	 */
+	double Error (const size_t n, const std::vector<double>& times) const {
+		std::vector<T> offsets, weights;
+		Quadrature (n, times.back(), offsets, weights);
+		double err = 0.;
+		for (size_t i = 0; i < times.size(); ++i) {
+			double re = 0., im = 0.;
+			for (size_t j = 0; j < n; ++j) {
+				const double phi = (offsets[j] - _spin.cs()) * times[i];
+				re += weights[j] * std::cos(phi);
+				im += weights[j] * std::sin(phi);
+			}
+			re -= Dephasing (times[i]);
+			err = std::max (err, std::sqrt (re*re + im*im));
+		}
+		return err;
+	}
+
+	/**
+	 * @brief Fewest isochromats (doubling, then bisection) whose free
+	 *        precession matches the voxel's to tol at the given times
+	 *        (ascending), e.g. the echo times
+	 *
+	 * @param times  Times since in phase
+	 * @param tol    Tolerance (fraction of M0)
+	 * @param max    Upper limit
+	 * @return       Number of isochromats (max if not reached)
+	 */
+	size_t Resolution (const std::vector<double>& times, const double tol,
+			const size_t max = 1 << 16) const {
+		if (_width <= 0. || times.empty())
+			return 1;
+		size_t hi = 1;
+		while (hi < max && Error (hi, times) > tol)
+			hi = std::min (2*hi, max);
+		if (hi == max && Error (hi, times) > tol) {
+			std::cerr << "Voxel: " << max << " isochromats short of tolerance " << tol << std::endl;
+			return max;
+		}
+		size_t lo = hi/2; // Fails (or 0)
+		while (hi - lo > 1) {
+			const size_t mid = (lo + hi)/2;
+			if (Error (mid, times) > tol)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		return hi;
+	}
+
+	/**
+	 * @brief Fewest isochromats for free precession from tmin to tmax,
+	 *        checked on a grid resolving the fastest isochromat. A
+	 *        Lorentzian decays with a cusp at 0 no finite set of isochromats
+	 *        follows, tmin > 0 bounds their number.
+	 */
+	size_t Resolution (const double tmin, const double tmax, const double tol,
+			const size_t max = 1 << 16) const {
+		if (_width <= 0.)
+			return 1;
+		size_t n = 1;
+		for (; n < max; n = std::min (2*n, max)) // Grid for the next candidate
+			if (Error (n, Grid (n, tmin, tmax)) <= tol)
+				break;
+		return Resolution (Grid (n, tmin, tmax), tol, max);
+	}
+
+private:
+
+	/** Times tmin ... tmax, 8 per period of the fastest of n isochromats **/
+	std::vector<double> Grid (const size_t n, const double tmin, const double tmax) const {
+		std::vector<T> offsets, weights;
+		Quadrature (n, tmax, offsets, weights);
+		const double w = std::fabs (offsets.back() - _spin.cs());
+		const size_t m = 64 + (size_t) std::ceil (8. * w * (tmax - tmin) / TWOPI);
+		std::vector<double> ret (m);
+		for (size_t i = 0; i < m; ++i)
+			ret[i] = tmin + (tmax - tmin) * i / (m-1);
+		return ret;
+	}
+
+	Spin<T> _spin;
+	Spread _spread;
+	T _width;
+
+};
+
+#endif /* VOXEL_HPP_ */
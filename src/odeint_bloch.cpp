@@ -1,15 +1,95 @@
 #include "Bloch.hpp"
 #include "Recorder.hpp"
+#include "Simulation.hpp"
+#include "Distributed.hpp"
+#include "Scenario.hpp"
+#include "Server.hpp"
 
 #include <boost/numeric/odeint.hpp>
 
+#include <cstring>
+
 using namespace boost::numeric::odeint;
 
+static void usage (const char* name) {
+	std::cerr << "Usage: " << name << " [-c config] [-s scenarios ...] [-r] [key=value ...]\n"
+			  << "  -c  stepper config file (key = value lines)\n"
+			  << "  -s  scenario file, run all scenarios in it (repeatable)\n"
+			  << "  -r  restart scenarios from their checkpoints\n"
+			  << "  -S  server mode on Unix socket path, - for stdin/stdout\n"
+			  << "  stepper = euler|rk4|cash_karp54|dopri5|fehlberg78|rosenbrock4|\n"
+			  << "            splitting|magnus4 (fixed only)\n"
+			  << "  mode    = fixed|controlled|dense\n"
+			  << "  abs_tol, rel_tol, dt (default 1e-6, 1e-6, 1e-8)\n"
+			  << "  frame   = rf|spin\n";
+}
+
 int main (int argc, char **argv) {
 
+	Communicator mpi (argc, argv); // MPI runs: mpirun -np N odeint_bloch -s ...
+
+	/** Stepper: config file, then command line **/
+	StepperConfig config;
+	std::vector<std::string> scenario_files;
+	std::string server;
+	bool restart = false;
+	for (int i = 1; i < argc; ++i) {
+		bool ok = false;
+		if (!strcmp(argv[i], "-c") && i+1 < argc)
+			ok = config.Read (argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i+1 < argc)
+			ok = (scenario_files.push_back (argv[++i]), true);
+		else if (!strcmp(argv[i], "-r"))
+			ok = restart = true;
+		else if (!strcmp(argv[i], "-S") && i+1 < argc)
+			ok = !(server = argv[++i]).empty();
+		else if (strchr(argv[i], '='))
+			ok = config.Parse (argv[i]);
+		if (!ok) {
+			usage (argv[0]);
+			return 1;
+		}
+	}
+	if (!config.Valid()) {
+		std::cerr << "Unsupported stepper configuration " << config << std::endl;
+		return 1;
+	}
+
+	/** Server: requests until EOF / stop request **/
+	if (!server.empty()) {
+		if (Communicator::Size() > 1) {
+			std::cerr << "Server mode runs on a single rank" << std::endl;
+			return 1;
+		}
+		Server<double> srv (config);
+		bool ok = (server == "-") ? srv.Serve (0, 1) : srv.Listen (server);
+		srv.Report (std::cerr);
+		return ok ? 0 : 1;
+	}
+
+	/** Batch: scenarios with stepper defaults from above, one process **/
+	if (!scenario_files.empty()) {
+		std::vector<Scenario<double> > scenarios;
+		for (size_t i = 0; i < scenario_files.size(); ++i)
+			if (!ReadScenarios (scenario_files[i], scenarios, config))
+				return 1;
+		Batch<double> batch (restart);
+		Timer timer;
+		for (size_t i = 0; i < scenarios.size(); ++i)
+			batch.Run (scenarios[i]);
+		if (Communicator::Rank() == 0)
+			std::cerr << scenarios.size() << " scenarios in " << 1.e-9*timer.Lap() << "s ("
+					  << batch.RFCacheSize() << " RF events)" << std::endl;
+		return 0;
+	}
+
+	if (Communicator::Rank() != 0) // Demo: single rank
+		return 0;
+
 	typedef std::complex<double> cdouble;
 	typedef boost::tuple<NDData<double>, NDData<cdouble> >  RFData;
 	Bloch<double>& Env = Bloch<double>::Instance();
+	ArenaScope run; // Run's temporaries, released at exit
 	Recorder<SAVE> recorder;
 
 	/** RF alternatives **/
@@ -23,7 +103,7 @@ int main (int argc, char **argv) {
 
 	/** Integrate IVP **/
 	state_type m = { 0., 0., 1. }; // initial magnetisation
-	integrate(bloch<double>, m, 0., 5., 1.e-8, recorder);
+	Integrate<double> (config, m, 0., 5., boost::ref(recorder));
 
 	/** Dump pulse **/
 	RFData rfd = rf.Dump(1000);
@@ -0,0 +1,1259 @@
+#include "Bloch.hpp"
+#include "Recorder.hpp"
+#include "Simulation.hpp"
+#include "Distributed.hpp"
+#include "BlochMcConnell.hpp"
+#include "EPG.hpp"
+#include "Incremental.hpp"
+#include "Stream.hpp"
+#include "Voxel.hpp"
+#include "Benchmark.hpp"
+
+#include <boost/numeric/odeint.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <sys/resource.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace boost::numeric::odeint;
+
+/** Bloch RHS at times sweeping through the pulse **/
+struct RHSBench {
+	size_t n;
+	RHSBench () : n(100000) {}
+	double operator() () {
+		state_type m = {{ 0., 0., 1. }}, dm;
+		for (size_t i = 0; i < n; ++i) {
+			bloch<double> (m, dm, 1.e-7 * (i % 100000));
+			escape (dm);
+		}
+		return n;
+	}
+};
+
+/** RF evaluation **/
+template<class R> struct RFBench {
+	const R& rf;
+	size_t n;
+	RFBench (const R& r) : rf(r), n(100000) {}
+	double operator() () {
+		double dt = rf.Duration() / n;
+		for (size_t i = 0; i < n; ++i) {
+			std::complex<double> v = rf(i*dt);
+			escape (v);
+		}
+		return n;
+	}
+};
+
+/** Batched RF evaluation into an aligned buffer **/
+template<class R> struct RFBatchBench {
+	const R& rf;
+	NDData<double> t;
+	NDData<std::complex<double> > out;
+	RFBatchBench (const R& r, size_t n = 100000) : rf(r), t(n), out(n) {
+		for (size_t i = 0; i < n; ++i)
+			t[i] = i * rf.Duration() / n;
+	}
+	double operator() () {
+		rf.Evaluate (t.Ptr(), t.Size(), out.Ptr());
+		escape (out);
+		return t.Size();
+	}
+};
+
+/** RF dump in memory (threads for large n) or streamed to HDF5 **/
+struct DumpBench {
+	const RF<double>& rf;
+	size_t n;
+	std::string fname;
+	DumpBench (const RF<double>& r, size_t s, const std::string& f = "") :
+		rf(r), n(s), fname(f) {}
+	double operator() () {
+		if (fname.empty()) {
+			boost::tuple<NDData<double>, NDData<std::complex<double> > > d = rf.Dump (n);
+			escape (d);
+		} else {
+			HDF5File f (fname, OUT);
+			rf.Dump (f, n);
+			fclose (f);
+		}
+		return n;
+	}
+};
+
+/** Demo: adiabatic inversion, single spin, 5s **/
+struct DemoBench {
+	double operator() () {
+		state_type m = {{ 0., 0., 1. }};
+		integrate (bloch<double>, m, 0., 5., 1.e-8, null_observer());
+		escape (m);
+		return 1;
+	}
+};
+
+/** Demo with Recorder<SAVE>: Difference to DemoBench is recorder overhead **/
+struct RecorderBench {
+	double operator() () {
+		Recorder<SAVE>* recorder = new Recorder<SAVE> ("");
+		state_type m = {{ 0., 0., 1. }};
+		integrate (bloch<double>, m, 0., 5., 1.e-8, boost::ref(*recorder));
+		delete recorder;
+		return 1;
+	}
+};
+
+/** Recorder observer calls only **/
+struct RecorderPushBench {
+	double operator() () {
+		Recorder<SAVE> recorder ("");
+		state_type m = {{ 0., 0., 1. }};
+		for (size_t i = 0; i < 100000; ++i)
+			recorder (m, 1.e-6*i);
+		return 100000;
+	}
+};
+
+/** Sample: One integration per spin over the pulse duration, all threads **/
+struct SampleBench {
+	const Sample<double>& sample;
+	double t1;
+	SampleBench (const Sample<double>& s, double t) : sample(s), t1(t) {}
+	double operator() () {
+		Sample<double> s (sample);
+		state_type m0 = {{ 0., 0., 1. }};
+		NDData<double> m = Simulate (s, Bloch<double>::Instance(), m0, 0., t1);
+		escape (m);
+		return s.Size();
+	}
+};
+
+/** Sample with checkpoints every interval s (negative: none) **/
+struct CheckpointBench {
+	const Sample<double>& sample;
+	double t1, interval;
+	std::string fname;
+	size_t saved;
+	CheckpointBench (const Sample<double>& s, double t, double i, const std::string& f) :
+		sample(s), t1(t), interval(i), fname(f), saved(0) {}
+	double operator() () {
+		Sample<double> s (sample);
+		state_type m0 = {{ 0., 0., 1. }};
+		Checkpoint checkpoint (fname, interval);
+		NDData<double> m = Simulate (s, Bloch<double>::Instance(), m0, 0., t1,
+				StepperConfig(), (interval < 0.) ? 0 : &checkpoint);
+		escape (m);
+		saved += checkpoint.Saved();
+		return s.Size();
+	}
+};
+
+/** Sampled RF by cached rotations: spins sharing B1 scale and off-resonance
+ *  (cached after the first call), or each at its own off-resonance (cache
+ *  cleared, rotations computed per spin) **/
+struct RotationBench {
+	const SampledRF<double>& rf;
+	const Sample<double>& sample;
+	bool shared;
+	std::vector<state_type> m;
+	RotationBench (const SampledRF<double>& r, const Sample<double>& s, bool sh) :
+		rf(r), sample(s), shared(sh), m(s.Size()) {}
+	double operator() () {
+		const state_type m0 = {{ 0., 0., 1. }};
+		std::fill (m.begin(), m.end(), m0);
+		if (shared) {
+			rf.Apply (m, 1., 0.);
+		} else {
+			const_cast<SampledRF<double>&>(rf).ClearCache();
+			for (size_t i = 0; i < m.size(); ++i)
+				rf.Apply (m[i], 1., sample[i].cs());
+		}
+		escape (m);
+		return m.size();
+	}
+};
+
+/** Spins integrated from 0 to t1 in the environment's events, e.g. a short
+ *  T2 sample (stiff): adiabatic inversion and 1s relaxation per spin.
+ *  Steps counted over all calls. **/
+struct StiffBench {
+	const std::vector<Spin<double> >& spins;
+	StepperConfig config;
+	double t1, steps;
+	StiffBench (const std::vector<Spin<double> >& s, const StepperConfig& c, double t) :
+		spins(s), config(c), t1(t), steps(0.) {}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		for (size_t i = 0; i < spins.size(); ++i) {
+			env.SetSpin (spins[i]);
+			state_type m = {{ 0., 0., 1. }};
+			steps += Integrate<double> (config, m, 0., t1, null_observer());
+			escape (m);
+		}
+		return spins.size();
+	}
+};
+
+/** Bloch-McConnell: Z-spectrum, all offsets integrated as one batch over the
+ *  saturation pulse **/
+struct McConnellBench {
+	const BlochMcConnell<double>& mc;
+	double t1, steps;
+	McConnellBench (const BlochMcConnell<double>& m, double t) : mc(m), t1(t), steps(0.) {}
+	double operator() () {
+		mc_state_type m = mc.Equilibrium();
+		steps += mc.Integrate (m, 0., t1);
+		escape (m);
+		return mc.Spins();
+	}
+};
+
+/** Pools at 3T (1ppm = 128Hz): water, amide, amine, NOE, semisolid MT **/
+static BlochMcConnell<double>
+CESTModel (const size_t n_pools, const std::vector<double>& offsets) {
+	const double ppm = TWOPI * 128.;
+	Pool<double> all[5] = {
+		Pool<double> (1.,     1.3, 70.e-3,   0.),
+		Pool<double> (9.e-4,  1.,  10.e-3,   3.5*ppm),
+		Pool<double> (9.e-4,  1.,  10.e-3,   2.0*ppm),
+		Pool<double> (5.e-3,  1.,  5.e-3,   -3.5*ppm),
+		Pool<double> (5.e-2,  1.,  1.e-4,   -2.6*ppm) };
+	double k[5] = { 0., 30., 1000., 20., 20. }; // To water
+	BlochMcConnell<double> mc (std::vector<Pool<double> > (all, all + n_pools), offsets);
+	for (size_t p = 1; p < n_pools; ++p)
+		mc.Exchange (p, 0, k[p]);
+	return mc;
+}
+
+/** CPMG train: 90x excitation centred on 0, refocusing pulses (alpha, phase
+ *  y) centred on (2k+1) tau, echoes at 2k tau. Hard pulses of 20us. **/
+struct CPMG {
+	size_t echoes;
+	double tau;
+	Spin<double> spin;
+	std::vector<HardRF<double> > rfs;
+	CPMG (const size_t n, const double t, const double alpha, const Spin<double>& s) :
+		echoes(n), tau(t), spin(s) {
+		const double d = 20.e-6;
+		rfs.push_back (HardRF<double> (-.5*d, .5*d, std::complex<double>(.25*TWOPI/(GAMMA*d), 0.)));
+		for (size_t k = 0; k < n; ++k)
+			rfs.push_back (HardRF<double> ((2*k+1)*tau - .5*d, (2*k+1)*tau + .5*d,
+					std::complex<double>(0., alpha/(GAMMA*d))));
+	}
+	void Setup () const {
+		Bloch<double>& env = Bloch<double>::Instance();
+		env.ClearEvents();
+		for (size_t i = 0; i < rfs.size(); ++i)
+			env.AddEvent (rfs[i]);
+	}
+};
+
+/** Transverse magnetisation at the echoes **/
+struct EchoObserver {
+	std::vector<std::complex<double> >& echoes;
+	double tau;
+	EchoObserver (std::vector<std::complex<double> >& e, double t) : echoes(e), tau(t) {}
+	void operator() (const state_type& m, double t) {
+		size_t k = (size_t) (t/(2.*tau) + .5);
+		if (k > 0 && std::fabs(t - 2.*k*tau) < 1.e-3*tau)
+			echoes[k-1] = std::complex<double> (m[0], m[1]);
+	}
+};
+
+/** CPMG echoes of one voxel, EPG with dephasing period tau **/
+struct EPGTrainBench {
+	const CPMG& cpmg;
+	EPG<double> epg;
+	std::vector<std::complex<double> > echoes;
+	EPGTrainBench (const CPMG& c) :
+		cpmg(c), epg(Bloch<double>::Instance().GetEvents(), c.tau), echoes(c.echoes) {}
+	double operator() () {
+		state_type m = {{ 0., 0., 1. }};
+		EchoObserver obs (echoes, cpmg.tau);
+		epg.Run (cpmg.spin, m, 2.*cpmg.echoes*cpmg.tau, boost::ref(obs));
+		escape (echoes);
+		return 1;
+	}
+};
+
+/** CPMG echoes of one voxel, Bloch equations of n isochromats dephasing by
+ *  one turn per tau. Integration is broken at the pulse edges (the adaptive
+ *  stepper must not step over a pulse), a gap of 1ps between pulse and free
+ *  segments keeps edge evaluations out of the other. **/
+struct IsochromatTrainBench {
+	const CPMG& cpmg;
+	size_t n;
+	StepperConfig config;
+	double steps;
+	std::vector<std::complex<double> > echoes;
+	IsochromatTrainBench (const CPMG& c, size_t i, const StepperConfig& cf) :
+		cpmg(c), n(i), config(cf), steps(0.), echoes(c.echoes) {}
+	size_t Segment (state_type& m, double t0, double t1) {
+		return Integrate<double> (config, m, t0, t1, null_observer());
+	}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		const double eps = 1.e-12;
+		std::fill (echoes.begin(), echoes.end(), std::complex<double>(0.,0.));
+		for (size_t i = 0; i < n; ++i) {
+			const Spin<double>& s = cpmg.spin;
+			env.SetSpin (Spin<double> (s.pd(), 0., 0., 0., s.t1(), s.t2(),
+					s.cs() + TWOPI*i/(n*cpmg.tau)));
+			state_type m = {{ 0., 0., 1. }};
+			const std::vector<double>& exc = cpmg.rfs[0].TPOIs();
+			steps += Segment (m, exc.front(), exc.back());
+			double t = exc.back() + eps;
+			for (size_t k = 0; k < cpmg.echoes; ++k) {
+				const std::vector<double>& ref = cpmg.rfs[k+1].TPOIs();
+				steps += Segment (m, t, ref.front() - eps);
+				steps += Segment (m, ref.front(), ref.back());
+				t = 2.*(k+1)*cpmg.tau;
+				steps += Segment (m, ref.back() + eps, t);
+				echoes[k] += std::complex<double> (m[0], m[1]) / (double)n;
+			}
+		}
+		escape (echoes);
+		return 1;
+	}
+};
+
+/** FLASH: n hard pulses (alpha, 100us) every TR, RF spoiled with a phase
+ *  increment growing by phi0 per TR, ideal spoilers at the end of each TR **/
+struct FLASH {
+	size_t n;
+	double tr, d;
+	Spin<double> spin;
+	std::vector<HardRF<double> > rfs;
+	std::vector<double> phases;
+	std::vector<Spoiler<double> > spoilers;
+	FLASH (const size_t trs, const double t, const double alpha, const double phi0,
+			const Spin<double>& s) : n(trs), tr(t), d(100.e-6), spin(s) {
+		for (size_t k = 0; k < n; ++k) {
+			phases.push_back (std::fmod (.5*phi0*k*(k+1), TWOPI));
+			rfs.push_back (HardRF<double> (k*tr, k*tr + d,
+					std::polar (alpha/(GAMMA*d), phases.back())));
+			spoilers.push_back (Spoiler<double> ((k+1)*tr));
+		}
+	}
+	/** Ernst steady state signal after the pulse, relaxation during the
+	 *  pulse neglected **/
+	double Ernst (const double alpha) const {
+		const double e1 = std::exp(-tr/spin.t1());
+		return spin.pd() * std::sin(alpha) * (1.-e1) / (1.-e1*std::cos(alpha));
+	}
+};
+
+/** FLASH signal (demodulated by the RF phase) after every pulse: either one
+ *  isochromat and ideal spoilers or n isochromats dephasing by one turn per
+ *  TR. The environment is set up per TR with that TR's events. **/
+struct FLASHBench {
+	const FLASH& flash;
+	size_t n;
+	bool spoil;
+	StepperConfig config;
+	double steps;
+	std::vector<std::complex<double> > signal;
+	FLASHBench (const FLASH& f, size_t i, bool s, const StepperConfig& cf) :
+		flash(f), n(i), spoil(s), config(cf), steps(0.), signal(f.n) {}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		const double eps = 1.e-12;
+		std::fill (signal.begin(), signal.end(), std::complex<double>(0.,0.));
+		for (size_t i = 0; i < n; ++i) {
+			const Spin<double>& s = flash.spin;
+			env.SetSpin (Spin<double> (s.pd(), 0., 0., 0., s.t1(), s.t2(),
+					s.cs() + TWOPI*i/(n*flash.tr)));
+			state_type m = {{ 0., 0., 1. }};
+			for (size_t k = 0; k < flash.n; ++k) {
+				const double t = k*flash.tr;
+				env.ClearEvents();
+				env.AddEvent (flash.rfs[k]);
+				if (spoil)
+					env.AddEvent (flash.spoilers[k]);
+				steps += Integrate<double> (config, m, t, t + flash.d, null_observer());
+				signal[k] += std::complex<double> (m[0], m[1]) *
+						std::polar (1./n, -flash.phases[k]);
+				steps += Integrate<double> (config, m, t + flash.d + eps, (k+1)*flash.tr,
+						null_observer());
+			}
+		}
+		escape (signal);
+		return 1;
+	}
+};
+
+/** FLASH train as one sequence (all events at once) over a sample, every
+ *  call with the last flip angle changed: incremental re-simulation or, for
+ *  reference, a plain Simulate() **/
+struct IncrementalBench {
+	const FLASH& flash;
+	const Sample<double>& sample;
+	bool incremental;
+	Incremental<double> inc;
+	size_t calls;
+	NDData<double> m;
+	IncrementalBench (const FLASH& f, const Sample<double>& s, bool i) :
+		flash(f), sample(s), incremental(i), calls(0) {}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		const std::vector<double>& tp = flash.rfs.back().TPOIs();
+		HardRF<double> last (tp.front(), tp.back(),
+				flash.rfs.back()(tp.front()) * (1. + .1*(calls++ % 2)));
+		env.ClearEvents();
+		for (size_t k = 0; k < flash.n; ++k) {
+			env.AddEvent ((k+1 < flash.n) ? flash.rfs[k] : last);
+			env.AddEvent (flash.spoilers[k]);
+		}
+		Sample<double> s (sample);
+		state_type m0 = {{ 0., 0., 1. }};
+		m = incremental ? inc.Simulate (s, env, m0, 0., flash.n*flash.tr) :
+				Simulate (s, env, m0, 0., flash.n*flash.tr);
+		escape (m);
+		return s.Size();
+	}
+};
+
+/** FLASH train of n TRs, one isochromat, all events registered: every
+ *  pulse and spoiler materialised or one repeat block of a template pulse,
+ *  quadratic phase table and a repeated spoiler. Integrated TR by TR, the
+ *  transverse magnetisation after each pulse demodulated. **/
+struct RepeatBench {
+	size_t n;
+	double tr, d;
+	bool repeat;
+	std::vector<HardRF<double> > rfs;
+	std::vector<Spoiler<double> > spoilers;
+	HardRF<double> pulse;
+	RepeatRF<double> block;
+	Spoiler<double> spoiler;
+	std::vector<std::complex<double> > signal;
+	double steps;
+	RepeatBench (const size_t trs, const double t, const double alpha, const double phi0,
+			const bool r) : n(trs), tr(t), d(100.e-6), repeat(r),
+			pulse (0., d, alpha/(GAMMA*d)), block (0., tr, n), spoiler (tr, 0., tr, n),
+			signal(n), steps(0.) {
+		block.Add (pulse);
+		block.Phases (RepeatRF<double>::QuadraticPhases (n, phi0));
+		if (!repeat)
+			for (size_t k = 0; k < n; ++k) {
+				rfs.push_back (HardRF<double> (k*tr, k*tr + d,
+						std::polar (alpha/(GAMMA*d), block.Phases()[k])));
+				spoilers.push_back (Spoiler<double> ((k+1)*tr));
+			}
+	}
+	/** Bytes of the event descriptions **/
+	size_t Bytes () const {
+		return repeat ? sizeof(block) + sizeof(pulse) + sizeof(spoiler) + n*sizeof(double) :
+				n * (sizeof(HardRF<double>) + sizeof(Spoiler<double>) + 3*sizeof(double));
+	}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		env.SetSpin (Spin<double> (1., 0., 0., 0., 1., 60.e-3, 0.));
+		env.ClearEvents();
+		if (repeat) {
+			env.AddEvent (block);
+			env.AddEvent (spoiler);
+		} else {
+			for (size_t k = 0; k < n; ++k) {
+				env.AddEvent (rfs[k]);
+				env.AddEvent (spoilers[k]);
+			}
+		}
+		const StepperConfig config;
+		state_type m = {{ 0., 0., 1. }};
+		for (size_t k = 0; k < n; ++k) {
+			steps += Integrate<double> (config, m, k*tr, k*tr + d, null_observer());
+			signal[k] = std::complex<double> (m[0], m[1]) * std::polar (1., -block.Phases()[k]);
+			steps += Integrate<double> (config, m, k*tr + d, (k+1)*tr, null_observer());
+		}
+		escape (signal);
+		return n;
+	}
+};
+
+/** GRE FID of a voxel after ideal excitation (all isochromats along x),
+ *  signal at the readout times: analytic kernel Voxel::FID() (n = 0) or n
+ *  isochromats integrated through the readouts **/
+struct VoxelFIDBench {
+	const Voxel<double>& voxel;
+	size_t n;
+	double steps;
+	const std::vector<double>& times;
+	std::vector<std::complex<double> > signal;
+	VoxelFIDBench (const Voxel<double>& v, size_t i, const std::vector<double>& t) :
+		voxel(v), n(i), steps(0.), times(t), signal(t.size()) {}
+	double operator() () {
+		const state_type m0 = {{ 1., 0., 0. }};
+		if (!n) {
+			for (size_t k = 0; k < times.size(); ++k) {
+				const state_type m = voxel.FID (m0, times[k]);
+				signal[k] = std::complex<double> (m[0], m[1]);
+			}
+			escape (signal);
+			return 1;
+		}
+		Bloch<double>& env = Bloch<double>::Instance();
+		std::fill (signal.begin(), signal.end(), std::complex<double>(0.,0.));
+		std::vector<double> w;
+		const Sample<double> iso = voxel.Isochromats (n, times.back(), w);
+		for (size_t i = 0; i < n; ++i) {
+			env.SetSpin (iso[i]);
+			state_type m = m0;
+			double t = 0.;
+			for (size_t k = 0; k < times.size(); ++k) {
+				steps += Integrate<double> (StepperConfig(), m, t, times[k], null_observer());
+				t = times[k];
+				signal[k] += w[i] * std::complex<double> (m[0], m[1]);
+			}
+		}
+		escape (signal);
+		return 1;
+	}
+};
+
+/** Steps of one spin from 0 to t1, summed: pulled from a Stream or
+ *  recorded (Recorder<SAVE>, memory only) first **/
+struct StepStreamBench {
+	double t1;
+	bool stream;
+	state_type sum;
+	StepStreamBench (const double t, const bool s) : t1(t), stream(s) {}
+	double operator() () {
+		const state_type m0 = {{ 0., 0., 1. }};
+		size_t n = 0;
+		sum[0] = sum[1] = sum[2] = 0.;
+		if (stream) {
+			Stream<double> s (Bloch<double>::Instance(), StepperConfig(), m0, 0., t1);
+			for (Stream<double>::iterator it = s.begin(); it != s.end(); ++it, ++n)
+				for (size_t c = 0; c < 3; ++c)
+					sum[c] += it->m[c];
+		} else {
+			Recorder<SAVE> recorder ("");
+			state_type m = m0;
+			Integrate<double> (StepperConfig(), m, 0., t1, boost::ref(recorder));
+			NDData<double> times, data;
+			recorder.Get (times, data);
+			for (n = 0; n < times.Size(); ++n)
+				for (size_t c = 0; c < 3; ++c)
+					sum[c] += data(n,c);
+		}
+		escape (sum);
+		return n;
+	}
+};
+
+/** Signal of a sample at ADC times to HDF5: StreamSignal() pipeline or,
+ *  for reference, spin after spin into the whole signal, written last **/
+struct PipelineBench {
+	const Sample<double>& sample;
+	const std::vector<double>& adc;
+	std::string fname;
+	bool pipeline;
+	PipelineBench (const Sample<double>& s, const std::vector<double>& a,
+			const std::string& f, const bool p) : sample(s), adc(a), fname(f), pipeline(p) {}
+	double operator() () {
+		Bloch<double>& env = Bloch<double>::Instance();
+		const state_type m0 = {{ 0., 0., 1. }};
+		HDF5File f (fname, OUT);
+		if (pipeline) {
+			StreamSignal (f, sample, env, m0, adc, StepperConfig(), "/", 1024);
+		} else {
+			NDData<std::complex<double> > signal (adc.size());
+			NDData<double> times (adc.size(), ALLOC_NOINIT);
+			std::copy (adc.begin(), adc.end(), times.Ptr());
+			for (size_t i = 0; i < sample.Size(); ++i) {
+				env.SetSpin (sample[i]);
+				state_type m = m0;
+				signal[0] += std::complex<double> (m[0], m[1]);
+				for (size_t k = 1; k < adc.size(); ++k) {
+					Integrate<double> (StepperConfig(), m, adc[k-1], adc[k], null_observer());
+					signal[k] += std::complex<double> (m[0], m[1]);
+				}
+			}
+			f.Write (times, "times");
+			f.Write (signal, "signal");
+		}
+		fclose (f);
+		return sample.Size() * adc.size();
+	}
+};
+
+/** Minor page faults of this process so far **/
+static long
+MinorFaults () {
+	struct rusage u;
+	getrusage (RUSAGE_SELF, &u);
+	return u.ru_minflt;
+}
+
+/** User space data TLB load misses of this thread, read with Read() (-1:
+ *  no counter, e.g. perf_event_paranoid or a virtual machine) **/
+struct TLBCounter {
+	int fd;
+	TLBCounter () : fd(-1) {
+#if defined(__linux__)
+		struct perf_event_attr a;
+		memset (&a, 0, sizeof(a));
+		a.size = sizeof(a);
+		a.type = PERF_TYPE_HW_CACHE;
+		a.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		a.exclude_kernel = 1;
+		a.exclude_hv = 1;
+		fd = syscall (__NR_perf_event_open, &a, 0, -1, -1, 0);
+#endif
+	}
+	~TLBCounter () {
+#if defined(__linux__)
+		if (fd >= 0)
+			close (fd);
+#endif
+	}
+	long long Read () const {
+		long long n = -1;
+#if defined(__linux__)
+		if (fd < 0 || read (fd, &n, sizeof(n)) != sizeof(n))
+			return -1;
+#endif
+		return n;
+	}
+};
+
+/** Large buffer in an allocation mode: allocated and filled (page faults),
+ *  then read one double per 4kB page in rounds (TLB misses) **/
+struct PageBench {
+	size_t n;
+	AllocMode mode;
+	long faults;
+	long long tlb_misses;
+	size_t calls;
+	PageBench (const size_t s, const AllocMode m) :
+		n(s), mode(m), faults(0), tlb_misses(0), calls(0) {}
+	double operator() () {
+		static const TLBCounter tlb;
+		const long f0 = MinorFaults();
+		NDData<double> d (n, mode);
+		double* p = d.Ptr();
+		for (size_t i = 0; i < n; ++i)
+			p[i] = i;
+		faults += MinorFaults() - f0;
+		const long long m0 = tlb.Read();
+		double sum = 0.;
+		for (size_t r = 0; r < 8; ++r)
+			for (size_t i = r; i < n; i += 512)
+				sum += p[i];
+		escape (sum);
+		const long long m1 = tlb.Read();
+		tlb_misses = (m0 < 0 || tlb_misses < 0) ? -1 : tlb_misses + (m1 - m0);
+		++calls;
+		return 1;
+	}
+};
+
+/** HDF5 bandwidth **/
+struct H5WriteBench {
+	const NDData<double>& data;
+	std::string fname;
+	H5WriteBench (const NDData<double>& d, const std::string& f) : data(d), fname(f) {}
+	double operator() () {
+		HDF5File f (fname, OUT);
+		f.Write (data, "data");
+		fclose (f);
+		return 1;
+	}
+};
+struct H5ReadBench {
+	std::string fname;
+	size_t size;
+	H5ReadBench (const std::string& f) : fname(f), size(0) {}
+	double operator() () {
+		HDF5File f (fname, IN);
+		NDData<double> data = f.Read<double> ("data");
+		size = data.Size();
+		fclose (f);
+		return 1;
+	}
+};
+
+/**
+ * Distributed sample: Sample sharded over MPI ranks, gathered on rank 0.
+ * Fixed repetitions (collective calls must match on all ranks). One JSON
+ * line per call from rank 0, run for 1..N ranks by make scaling.
+ */
+static void
+ScalingBench (const Sample<double>& sample, const double t1, const size_t reps) {
+	Bloch<double>& env = Bloch<double>::Instance();
+	state_type m0 = {{ 0., 0., 1. }};
+	Sample<double> s (sample); // Warm up
+	Simulate<MPI> (s, env, m0, 0., t1);
+	Communicator::Barrier();
+	Timer timer;
+	for (size_t i = 0; i < reps; ++i) {
+		Sample<double> s (sample);
+		NDData<double> m = Simulate<MPI> (s, env, m0, 0., t1);
+		escape (m);
+	}
+	Communicator::Barrier();
+	double sec = 1.e-9 * timer.Lap() / reps;
+	if (Communicator::Rank() == 0) {
+#ifdef _OPENMP
+		int threads = omp_get_max_threads();
+#else
+		int threads = 1;
+#endif
+		std::cout << "{\"name\": \"mpi/sample_" << sample.Size() << "\", \"ranks\": "
+				  << Communicator::Size() << ", \"threads\": " << threads
+				  << ", \"reps\": " << reps << std::scientific << std::setprecision(6)
+				  << ", \"sec_per_run\": " << sec << ", \"spins_per_sec\": "
+				  << sample.Size()/sec << "}" << std::endl;
+	}
+}
+
+/**
+ * NDData allocation checks: moves, MulAdd() and chained arithmetic on a
+ * temporary allocate nothing, a chain on an lvalue no more than one copy.
+ * Failures are reported, the bench exits non-zero.
+ */
+static size_t
+AllocationCheck (const std::string& name, const size_t allocs, const size_t expected) {
+	const bool ok = (allocs == expected);
+	std::cerr << "  " << std::setw(32) << std::left << name << std::right << std::setw(14)
+			  << allocs << " allocs" << (ok ? "" : " FAILED, expected ") ;
+	if (!ok)
+		std::cerr << expected;
+	std::cerr << std::endl;
+	return ok ? 0 : 1;
+}
+
+static size_t
+AllocationChecks () {
+	size_t failed = 0, a0;
+	NDData<double> a (1 << 20), b;
+	for (size_t i = 0; i < a.Size(); ++i)
+		a[i] = i;
+	b = a * 2. + 1.; // Warm up (thread pool)
+
+	a0 = AllocationCount();
+	NDData<double> c (a);
+	escape (c);
+	const size_t copy = AllocationCount() - a0;
+
+	a0 = AllocationCount();
+	NDData<double> d (std::move (c));
+	escape (d);
+	failed += AllocationCheck ("alloc/move_construct", AllocationCount() - a0, 0);
+
+	a0 = AllocationCount();
+	b = std::move (d);
+	escape (b);
+	failed += AllocationCheck ("alloc/move_assign", AllocationCount() - a0, 0);
+
+	a0 = AllocationCount();
+	b.MulAdd (2., 1.);
+	escape (b);
+	failed += AllocationCheck ("alloc/muladd", AllocationCount() - a0, 0);
+
+	a0 = AllocationCount();
+	b = std::move (b) * 2. / 3. + 1.;
+	escape (b);
+	failed += AllocationCheck ("alloc/chain_temporary", AllocationCount() - a0, 0);
+
+	a0 = AllocationCount();
+	NDData<double> e = a * 2. / 3. + 1.;
+	escape (e);
+	failed += AllocationCheck ("alloc/chain_lvalue", AllocationCount() - a0, copy);
+
+	return failed;
+}
+
+static void usage (const char* name) {
+	std::cerr << "Usage: " << name << " [-q] [-m] [-n spins] [-t seconds] [-o file.json]\n"
+			  << "  -q  quick run (10^3 spins, short measurement)\n"
+			  << "  -m  MPI scaling: distributed sample benchmark only (mpirun -np N)\n"
+			  << "  -n  number of spins in sample benchmark (default 10^5)\n"
+			  << "  -t  minimum measurement time per benchmark (default .5s)\n"
+			  << "  -o  JSON output (default stdout)\n";
+}
+
+int main (int argc, char **argv) {
+
+	Communicator mpi (argc, argv);
+	size_t n_spins = 100000;
+	bool scaling = false;
+	double min_time = .5;
+	std::string out;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-q")) {
+			n_spins = 1000;
+			min_time = .1;
+		} else if (!strcmp(argv[i], "-m")) {
+			scaling = true;
+		} else if (!strcmp(argv[i], "-n") && i+1 < argc) {
+			n_spins = atol(argv[++i]);
+		} else if (!strcmp(argv[i], "-t") && i+1 < argc) {
+			min_time = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-o") && i+1 < argc) {
+			out = argv[++i];
+		} else {
+			usage (argv[0]);
+			return 1;
+		}
+	}
+
+	Benchmark bench ("odeint_bloch", min_time);
+	Bloch<double>& env = Bloch<double>::Instance();
+
+	/** Same world as odeint_bloch **/
+	AdiabaticRF<double> rf (0., 10.e-3, 200.0e-6);
+	HardRF<double> hrf (0., 200.e-6, std::complex<double>(0.,1.845e-4));
+	Spin<double> spin (1., 0., 0., 0., 1., 60.e-3, 0.);
+	env.SetSpin (spin);
+	env.AddEvent (rf);
+
+	Sample<double> sample;
+	for (size_t i = 0; i < n_spins; ++i) // Off-resonance spread +/-500Hz
+		sample.PushBack (Spin<double> (1., 0., 0., 0., 1., 60.e-3,
+				TWOPI * 1000. * ((double)i/n_spins - .5)));
+
+	if (scaling) {
+		ScalingBench (sample, rf.Duration(), std::max(1, (int)(10.*min_time)));
+		return 0;
+	} else if (Communicator::Size() > 1) {
+		std::cerr << "Benchmarks other than -m run on a single rank" << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Checking allocations" << std::endl;
+	if (const size_t failed = AllocationChecks()) {
+		std::cerr << failed << " allocation checks failed" << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Running benchmarks" << std::endl;
+
+	RHSBench rhs;
+	bench.Run ("rhs/bloch", rhs);
+
+	RFBench<AdiabaticRF<double> > arfb (rf);
+	bench.Run ("rf/adiabatic", arfb);
+	RFBench<HardRF<double> > hrfb (hrf);
+	bench.Run ("rf/hard", hrfb);
+	RFBench<RF<double> > vrfb (rf);
+	bench.Run ("rf/dispatch", vrfb);
+	RFBatchBench<AdiabaticRF<double> > arfbb (rf);
+	bench.Run ("rf/adiabatic_batch", arfbb);
+	RFBatchBench<RF<double> > vrfbb (rf);
+	bench.Run ("rf/dispatch_batch", vrfbb);
+	DumpBench dump (rf, 1 << 22);
+	bench.Run ("rf/dump_4M", dump);
+
+	DemoBench demo;
+	bench.Run ("integrate/demo", demo);
+	RecorderBench rec;
+	bench.Run ("integrate/demo_recorder", rec);
+	RecorderPushBench push;
+	bench.Run ("recorder/push", push);
+
+	SampleBench sb (sample, rf.Duration());
+	std::stringstream sname;
+	sname << "integrate/sample_" << n_spins;
+	bench.Run (sname.str(), sb);
+
+	std::vector<Spin<double> > short_t2; // T2 20us-1ms, +/-500Hz
+	for (size_t i = 0; i < 32; ++i)
+		short_t2.push_back (Spin<double> (1., 0., 0., 0., 1., 2.e-5 * pow (50., i/31.),
+				TWOPI * 1000. * (i/31. - .5)));
+	StepperConfig explicit_config, implicit_config;
+	implicit_config.type = ROSENBROCK4;
+	StiffBench se (short_t2, explicit_config, 1.);
+	BenchResult& rse = bench.Run ("stiff/dopri5", se);
+	rse.steps = se.steps;
+	StiffBench si (short_t2, implicit_config, 1.);
+	BenchResult& rsi = bench.Run ("stiff/rosenbrock4", si);
+	rsi.steps = si.steps;
+
+	/** Frames: 90 degree hard pulse, 100ms free precession of water, fat
+	 *  (-440Hz, 3T) and strongly off-resonant (5kHz) spins, RF frame
+	 *  against spin frame. Deviation from an accurate RF frame run. **/
+	env.ClearEvents();
+	env.AddEvent (hrf);
+	const double frame_cs[3] = { 0., -440., 5000. };
+	const char* frame_names[3] = { "water", "fat", "offres_5k" };
+	StepperConfig rf_frame, spin_frame, accurate_frame;
+	spin_frame.frame = SPIN_FRAME;
+	accurate_frame.abs_tol = accurate_frame.rel_tol = 1.e-10;
+	for (size_t i = 0; i < 3; ++i) {
+		std::vector<Spin<double> > frame_spins (1, Spin<double> (1., 0., 0., 0., 1., 60.e-3,
+				TWOPI * frame_cs[i]));
+		env.SetSpin (frame_spins[0]);
+		state_type mr = {{ 0., 0., 1. }}, mf = mr, ms = mr;
+		Integrate<double> (accurate_frame, mr, 0., .1, null_observer());
+		Integrate<double> (rf_frame, mf, 0., .1, null_observer());
+		Integrate<double> (spin_frame, ms, 0., .1, null_observer());
+		double dev_rf = 0., dev_spin = 0.;
+		for (size_t j = 0; j < 3; ++j) {
+			dev_rf   = std::max (dev_rf,   std::fabs (mf[j] - mr[j]));
+			dev_spin = std::max (dev_spin, std::fabs (ms[j] - mr[j]));
+		}
+		std::cerr << "  frame " << frame_names[i] << ": max deviation " << dev_rf
+				  << " rf frame, " << dev_spin << " spin frame" << std::endl;
+		for (size_t f = 0; f < 2; ++f) {
+			StiffBench fb (frame_spins, f ? spin_frame : rf_frame, .1);
+			std::stringstream name;
+			name << "frame/" << FrameName[f ? SPIN_FRAME : RF_FRAME] << "_" << frame_names[i];
+			BenchResult& r = bench.Run (name.str(), fb);
+			r.steps = fb.steps;
+		}
+	}
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** Splitting steppers on the adiabatic pulse, 100 spins +/-500Hz: dopri5
+	 *  (default tolerances) against midpoint and Magnus 4 splitting with
+	 *  250 fixed steps. Deviation from accurate dopri5 over all spins. **/
+	std::vector<Spin<double> > split_spins;
+	for (size_t i = 0; i < 100; ++i)
+		split_spins.push_back (Spin<double> (1., 0., 0., 0., 1., 60.e-3,
+				TWOPI * 1000. * (i/100. - .5)));
+	StepperConfig split_configs[3], split_accurate;
+	split_configs[1].type = SPLITTING;
+	split_configs[2].type = MAGNUS4;
+	for (size_t k = 1; k < 3; ++k) {
+		split_configs[k].mode = FIXED;
+		split_configs[k].dt   = rf.Duration()/250.;
+	}
+	split_accurate.abs_tol = split_accurate.rel_tol = 1.e-10;
+	const char* split_names[3] = { "dopri5", "splitting_250", "magnus4_250" };
+	for (size_t k = 0; k < 3; ++k) {
+		double dev = 0.;
+		for (size_t i = 0; i < split_spins.size(); ++i) {
+			env.SetSpin (split_spins[i]);
+			state_type mr = {{ 0., 0., 1. }}, ms = mr;
+			Integrate<double> (split_accurate, mr, 0., rf.Duration(), null_observer());
+			Integrate<double> (split_configs[k], ms, 0., rf.Duration(), null_observer());
+			for (size_t j = 0; j < 3; ++j)
+				dev = std::max (dev, std::fabs (ms[j] - mr[j]));
+		}
+		std::cerr << "  splitting: " << split_names[k] << " max deviation " << dev << std::endl;
+		StiffBench spb (split_spins, split_configs[k], rf.Duration());
+		BenchResult& r = bench.Run (std::string("splitting/") + split_names[k], spb);
+		r.steps = spb.steps;
+	}
+	env.SetSpin (spin);
+
+	std::vector<double> offsets; // Z-spectrum +/-6ppm
+	for (size_t i = 0; i < 64; ++i)
+		offsets.push_back (TWOPI * 128. * 12. * (i/63. - .5));
+	HardRF<double> sat (0., 50.e-3, std::complex<double>(TWOPI*1.e-6, 0.)); // 1uT CW
+	env.ClearEvents();
+	env.AddEvent (sat);
+	size_t n_pools[4] = { 1, 2, 3, 5 };
+	for (size_t i = 0; i < 4; ++i) {
+		std::stringstream name;
+		name << "mcconnell/pools_" << n_pools[i] << "_offsets_64";
+		BlochMcConnell<double> mc = CESTModel (n_pools[i], offsets);
+		McConnellBench mcb (mc, sat.Duration());
+		BenchResult& r = bench.Run (name.str(), mcb);
+		r.steps = mcb.steps;
+	}
+
+	/** CPMG, 120 degree refocusing: EPG against isochromats (accurate
+	 *  integration) once, then both timed per echo train **/
+	CPMG cpmg (32, 5.e-3, TWOPI/3., Spin<double> (1., 0., 0., 0., 1., .1, 0.));
+	cpmg.Setup();
+	StepperConfig accurate;
+	accurate.abs_tol = accurate.rel_tol = 1.e-10;
+	EPGTrainBench epgb (cpmg);
+	epgb ();
+	IsochromatTrainBench ref (cpmg, 128, accurate);
+	ref ();
+	double dev = 0.;
+	for (size_t k = 0; k < cpmg.echoes; ++k)
+		dev = std::max (dev, std::abs (epgb.echoes[k] - ref.echoes[k]));
+	std::cerr << "  cpmg: EPG vs 128 isochromats, max echo deviation " << dev
+			  << " (echo 1: " << std::abs(ref.echoes[0]) << ")" << std::endl;
+	BenchResult& re = bench.Run ("cpmg/epg_echoes_32", epgb);
+	re.steps = 2*cpmg.echoes*re.calls;
+	IsochromatTrainBench isob (cpmg, 128, StepperConfig());
+	BenchResult& ri = bench.Run ("cpmg/ode_isochromats_128_echoes_32", isob);
+	ri.steps = isob.steps;
+
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** FLASH, 15 degrees, TR 10ms, 200 TRs (steady state): one isochromat
+	 *  with ideal spoilers against 128 isochromats dephasing per TR, RF
+	 *  spoiled (117 degrees) and not, then both timed per train **/
+	const double flip = 15./360.*TWOPI;
+	FLASH flash (200, 10.e-3, flip, 117./360.*TWOPI, Spin<double> (1., 0., 0., 0., 1., 60.e-3, 0.));
+	FLASH flash_g (200, 10.e-3, flip, 0., flash.spin);
+	FLASHBench spoiled (flash, 1, true, accurate);
+	spoiled ();
+	FLASHBench iso_rf (flash, 128, false, accurate), iso_g (flash_g, 128, false, accurate);
+	iso_rf ();
+	iso_g ();
+	double dev_rf = 0., dev_g = 0.;
+	for (size_t k = 0; k < flash.n; ++k) {
+		dev_rf = std::max (dev_rf, std::abs (std::abs(spoiled.signal[k]) - std::abs(iso_rf.signal[k])));
+		dev_g  = std::max (dev_g,  std::abs (std::abs(spoiled.signal[k]) - std::abs(iso_g.signal[k])));
+	}
+	std::cerr << "  flash: ideal spoiler, final signal " << std::abs(spoiled.signal.back())
+			  << " (Ernst " << flash.Ernst(flip) << "), 128 isochromats "
+			  << std::abs(iso_rf.signal.back()) << " RF spoiled, "
+			  << std::abs(iso_g.signal.back()) << " gradient only; max deviation "
+			  << dev_rf << " RF spoiled, " << dev_g << " gradient only" << std::endl;
+	FLASHBench spoiledb (flash, 1, true, StepperConfig());
+	BenchResult& rs = bench.Run ("flash/spoiler_trs_200", spoiledb);
+	rs.steps = spoiledb.steps;
+	FLASHBench isob_rf (flash, 128, false, StepperConfig());
+	BenchResult& rr = bench.Run ("flash/isochromats_128_trs_200", isob_rf);
+	rr.steps = isob_rf.steps;
+
+	/** Incremental re-simulation: FLASH over 64 spins (+/-50Hz), last flip
+	 *  angle changed. Re-run against a full run of the same sequence (bit
+	 *  identical) and against Simulate() (segmented vs not). **/
+	Sample<double> flash_sample;
+	for (size_t i = 0; i < 64; ++i)
+		flash_sample.PushBack (Spin<double> (1., 0., 0., 0., 1., 60.e-3, TWOPI * (i*100./63. - 50.)));
+	IncrementalBench incb (flash, flash_sample, true), incf (flash, flash_sample, true),
+			plain (flash, flash_sample, false);
+	incb ();
+	incb (); // Last pulse changed
+	incf.calls = 1;
+	incf (); // Full run of the same
+	plain.calls = 1;
+	plain ();
+	double inc_dev = 0., plain_dev = 0.;
+	for (size_t i = 0; i < incb.m.Size(); ++i) {
+		inc_dev   = std::max (inc_dev,   std::fabs (incb.m[i] - incf.m[i]));
+		plain_dev = std::max (plain_dev, std::fabs (incb.m[i] - plain.m[i]));
+	}
+	std::cerr << "  incremental: resumed at " << incb.inc.Resumed() << "s, " << incb.inc.Segments()
+			  << " of " << incf.inc.Segments() << " segments, max deviation from full run "
+			  << inc_dev << ", from Simulate() " << plain_dev << std::endl;
+	BenchResult& rfull = bench.Run ("incremental/flash_64_full", plain);
+	const double full_ns = rfull.ns / rfull.calls;
+	BenchResult& rinc = bench.Run ("incremental/flash_64_last_changed", incb);
+	std::cerr << "  incremental: " << full_ns / (rinc.ns / rinc.calls)
+			  << "x faster than a full run" << std::endl;
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** Repeat blocks: FLASH (15 degrees, TR 10ms, RF spoiled) of 1000 TRs
+	 *  with every event materialised against one repeat block, and of
+	 *  10000 TRs as repeat block. Timed per TR. **/
+	RepeatBench mat_1k (1000, 10.e-3, flip, 117./360.*TWOPI, false),
+			rep_1k (1000, 10.e-3, flip, 117./360.*TWOPI, true),
+			rep_10k (10000, 10.e-3, flip, 117./360.*TWOPI, true);
+	mat_1k ();
+	rep_1k ();
+	double rep_dev = 0.;
+	for (size_t k = 0; k < mat_1k.n; ++k)
+		rep_dev = std::max (rep_dev, std::abs (mat_1k.signal[k] - rep_1k.signal[k]));
+	std::cerr << "  repeat: max deviation from materialised events " << rep_dev << ", events "
+			  << mat_1k.Bytes() << " bytes (1000 TRs) against " << rep_1k.Bytes() << " (1000 TRs), "
+			  << rep_10k.Bytes() << " (10000 TRs, phase table)" << std::endl;
+	mat_1k.steps = rep_1k.steps = 0.;
+	BenchResult& rmat = bench.Run ("repeat/flash_trs_1000_materialised", mat_1k);
+	rmat.steps = mat_1k.steps;
+	const double mat_ns = rmat.ns / rmat.ops;
+	BenchResult& rrep = bench.Run ("repeat/flash_trs_1000_block", rep_1k);
+	rrep.steps = rep_1k.steps;
+	const double rep_ns = rrep.ns / rrep.ops;
+	BenchResult& rrep10 = bench.Run ("repeat/flash_trs_10000_block", rep_10k);
+	rrep10.steps = rep_10k.steps;
+	std::cerr << "  repeat: per TR " << mat_ns << "ns materialised, " << rep_ns
+			  << "ns block (1000 TRs), " << rrep10.ns / rrep10.ops << "ns block (10000 TRs)"
+			  << std::endl;
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** Voxel T2*: GRE FID, 32 readouts 1 ... 32ms, Lorentzian (T2' 16ms)
+	 *  and uniform 20Hz spreads. Analytic kernel against the fewest
+	 *  isochromats for 1e-3 (Voxel::Resolution()) and 1000 isochromats. **/
+	env.ClearEvents();
+	std::vector<double> readouts;
+	for (size_t k = 1; k <= 32; ++k)
+		readouts.push_back (1.e-3 * k);
+	const Spread spreads[2] = { LORENTZIAN_SPREAD, UNIFORM_SPREAD };
+	const char* spread_names[2] = { "lorentzian", "uniform" };
+	for (size_t i = 0; i < 2; ++i) {
+		Voxel<double> voxel (Spin<double> (1., 0., 0., 0., 1., .05, TWOPI*10.), spreads[i], 20.);
+		const size_t n = voxel.Resolution (readouts, 1.e-3);
+		VoxelFIDBench kernel (voxel, 0, readouts), fewest (voxel, n, readouts),
+				many (voxel, 1000, readouts);
+		kernel ();
+		fewest ();
+		many ();
+		double dev_fewest = 0., dev_many = 0.;
+		for (size_t k = 0; k < readouts.size(); ++k) {
+			dev_fewest = std::max (dev_fewest, std::abs (kernel.signal[k] - fewest.signal[k]));
+			dev_many   = std::max (dev_many,   std::abs (kernel.signal[k] - many.signal[k]));
+		}
+		std::cerr << "  voxel " << spread_names[i] << ": kernel vs " << n
+				  << " isochromats max deviation " << dev_fewest << ", vs 1000 " << dev_many
+				  << " (signal at 1ms " << std::abs(kernel.signal[0]) << ")" << std::endl;
+		std::stringstream name;
+		name << "voxel/" << spread_names[i] << "_kernel";
+		bench.Run (name.str(), kernel);
+		name.str ("");
+		name << "voxel/" << spread_names[i] << "_isochromats_" << n;
+		fewest.steps = 0.;
+		BenchResult& rv = bench.Run (name.str(), fewest);
+		rv.steps = fewest.steps;
+	}
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** Sampled RF: adiabatic pulse dumped to 512 samples. Validate cached
+	 *  rotations against the ODE (relaxation off), then time both over
+	 *  1000 spins (+/-500Hz) **/
+	SampledRF<double> srf (rf.Dump (512));
+	env.ClearEvents();
+	env.AddEvent (srf);
+	StepperConfig accurate_rf;
+	accurate_rf.abs_tol = accurate_rf.rel_tol = 1.e-10;
+	double rdev = 0.;
+	for (size_t i = 0; i < 11; ++i) {
+		const double cs = TWOPI * 100. * ((double)i - 5.);
+		state_type mo = {{ 0., 0., 1. }}, mr = mo;
+		env.SetSpin (Spin<double> (1., 0., 0., 0., 1.e9, 1.e9, cs));
+		Integrate<double> (accurate_rf, mo, 0., srf.Duration(), null_observer());
+		srf.Apply (mr, 1., cs);
+		for (size_t j = 0; j < 3; ++j)
+			rdev = std::max (rdev, std::fabs (mo[j] - mr[j]));
+	}
+	std::cerr << "  sampled rf: rotations vs ODE, max deviation " << rdev << std::endl;
+	Sample<double> rf_sample;
+	for (size_t i = 0; i < 1000; ++i)
+		rf_sample.PushBack (Spin<double> (1., 0., 0., 0., 1., 60.e-3,
+				TWOPI * 1000. * (i/1000. - .5)));
+	RotationBench rbs (srf, rf_sample, true);
+	bench.Run ("sampled_rf/rotations_512_cached", rbs);
+	RotationBench rbo (srf, rf_sample, false);
+	bench.Run ("sampled_rf/rotations_512_per_offset", rbo);
+	SampleBench srb (rf_sample, srf.Duration());
+	bench.Run ("sampled_rf/ode_512", srb);
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+	/** Allocation modes: 256MB buffer allocated, filled and read page by
+	 *  page. Minor page faults (getrusage) and data TLB load misses
+	 *  (perf_event_open, n/a without counter) per call. **/
+	const AllocMode page_modes[3] = { ALLOC_DEFAULT, ALLOC_NOINIT, ALLOC_NOINIT | ALLOC_HUGEPAGE };
+	const char* page_names[3] = { "default", "noinit", "noinit_hugepage" };
+	for (size_t i = 0; i < 3; ++i) {
+		PageBench pb (1 << 25, page_modes[i]);
+		bench.Run (std::string("alloc/fill_256MB_") + page_names[i], pb, (1 << 25) * sizeof(double));
+		std::cerr << "  alloc " << page_names[i] << ": " << pb.faults / (long) pb.calls
+				  << " minor faults, ";
+		if (pb.tlb_misses < 0)
+			std::cerr << "n/a";
+		else
+			std::cerr << pb.tlb_misses / (long long) pb.calls;
+		std::cerr << " dTLB load misses per call" << std::endl;
+	}
+
+	std::string h5 = "odeint_bloch_bench.h5";
+	NDData<double> data (1024, 8192); // 64MB
+	for (size_t i = 0; i < data.Size(); ++i)
+		data[i] = i;
+	H5WriteBench h5w (data, h5);
+	bench.Run ("hdf5/write_64MB", h5w, data.Size()*sizeof(double));
+	H5ReadBench h5r (h5);
+	bench.Run ("hdf5/read_64MB", h5r, data.Size()*sizeof(double));
+	remove (h5.c_str());
+	DumpBench dumps (rf, 1 << 24, h5);
+	bench.Run ("hdf5/dump_stream_16M", dumps, (1 << 24) * 3 * sizeof(double));
+	remove (h5.c_str());
+
+	/** Checkpoints: 1000 spins through the adiabatic pulse, none, every
+	 *  1ms of wall time (written while integration goes on) and after
+	 *  every spin **/
+	const double intervals[3] = { -1., 1.e-3, 0. };
+	const char* interval_names[3] = { "none", "1ms", "every_spin" };
+	for (size_t i = 0; i < 3; ++i) {
+		CheckpointBench cb (rf_sample, rf.Duration(), intervals[i], h5);
+		BenchResult& rc = bench.Run (std::string("checkpoint/sample_1000_") + interval_names[i], cb);
+		std::cerr << "  checkpoint " << interval_names[i] << ": " << (double) cb.saved / rc.calls
+				  << " snapshots per run" << std::endl;
+	}
+	remove (h5.c_str());
+
+	/** Streams: steps of the adiabatic pulse pulled from a Stream against
+	 *  recorded first. Pipeline: 90 degree pulse, 16 spins (+/-50Hz), 8192
+	 *  ADC samples every 10us, summed by shards of spins and written by
+	 *  StreamSignal() while simulating, against spin after spin and one
+	 *  write. **/
+	StepStreamBench steps_stream (rf.Duration(), true), steps_recorded (rf.Duration(), false);
+	bench.Run ("stream/steps_adiabatic_pulled", steps_stream);
+	bench.Run ("stream/steps_adiabatic_recorded", steps_recorded);
+	std::cerr << "  stream: sum of states pulled " << steps_stream.sum[2] << ", recorded "
+			  << steps_recorded.sum[2] << std::endl;
+	HardRF<double> rf90 (0., 200.e-6, .25*TWOPI/(GAMMA*200.e-6));
+	env.ClearEvents();
+	env.AddEvent (rf90);
+	Sample<double> adc_sample;
+	for (size_t i = 0; i < 16; ++i)
+		adc_sample.PushBack (Spin<double> (1., 0., 0., 0., 1., 60.e-3, TWOPI * (i*100./15. - 50.)));
+	std::vector<double> adc;
+	for (size_t k = 0; k < 8192; ++k)
+		adc.push_back (200.e-6 + 10.e-6*k);
+	const std::string h5_ref = h5 + ".ref";
+	PipelineBench pipe (adc_sample, adc, h5, true), serial (adc_sample, adc, h5_ref, false);
+	pipe ();
+	serial ();
+	{
+		HDF5File fp (h5, IN), fs (h5_ref, IN);
+		NDData<std::complex<double> > sp = fp.Read<std::complex<double> > ("signal"),
+				ss = fs.Read<std::complex<double> > ("signal");
+		double pipe_dev = (sp.Size() == ss.Size()) ? 0. : 1.;
+		for (size_t k = 0; k < std::min (sp.Size(), ss.Size()); ++k)
+			pipe_dev = std::max (pipe_dev, std::abs (sp[k] - ss[k]));
+		fclose (fp);
+		fclose (fs);
+		const size_t shards = std::min (std::max (std::thread::hardware_concurrency(), 1u), 16u);
+		std::cerr << "  pipeline: max deviation from serial " << pipe_dev << ", " << shards
+				  << " shards, buffers " << (shards + 1)*4*1024*sizeof(std::complex<double>)
+				  << " bytes" << std::endl;
+	}
+	BenchResult& rser = bench.Run ("stream/signal_16_adc_8192_serial", serial);
+	const double ser_ns = rser.ns / rser.calls;
+	BenchResult& rpipe = bench.Run ("stream/signal_16_adc_8192_pipeline", pipe);
+	std::cerr << "  pipeline: " << ser_ns / (rpipe.ns / rpipe.calls) << "x serial" << std::endl;
+	remove (h5.c_str());
+	remove (h5_ref.c_str());
+	env.ClearEvents();
+	env.AddEvent (rf);
+	env.SetSpin (spin);
+
+#ifdef PACKAGE_VERSION
+	std::string version (PACKAGE_VERSION);
+#else
+	std::string version ("unknown");
+#endif
+
+	if (out.empty()) {
+		bench.Report (std::cout, version);
+	} else {
+		std::ofstream ofs (out.c_str());
+		bench.Report (ofs, version);
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,391 @@
+#include "Bloch.hpp"
+#include "Simulation.hpp"
+#include "Stepper.hpp"
+#include "Benchmark.hpp"
+
+#include <boost/numeric/odeint.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace boost::numeric::odeint;
+
+/**
+ * Stepper accuracy versus cost: Integrate problems with known end state
+ * using different steppers and tolerances (step sizes for fixed step
+ * schemes) and report error, RHS evaluations and wall time. Points not
+ * dominated in (error, RHS evaluations) per problem are Pareto optimal.
+ */
+
+/** Bloch RHS counting its evaluations **/
+struct counted_bloch {
+	size_t* n;
+	counted_bloch (size_t* c) : n(c) {}
+	inline void operator() (const state_type& m, state_type& dm, double t) const {
+		++(*n);
+		bloch<double> (m, dm, t);
+	}
+};
+
+/** Test problem: environment, initial and reference end state **/
+struct Problem {
+	std::string name;
+	Spin<double> spin;
+	const RF<double>* rf;
+	state_type m0, ref;
+	double t0, t1;
+	void Setup () const {
+		Bloch<double>& env = Bloch<double>::Instance();
+		env.ClearEvents();
+		if (rf)
+			env.AddEvent (*rf);
+		env.SetSpin (spin);
+	}
+};
+
+/** One stepper run **/
+struct Result {
+	std::string problem, stepper;
+	double param;  /**< Tolerance (controlled) or step size (fixed) **/
+	double error;  /**< Max abs deviation from reference end state **/
+	size_t rhs;    /**< RHS evaluations **/
+	double ns;     /**< Wall time per integration **/
+	bool pareto;
+};
+
+inline static double
+max_error (const state_type& a, const state_type& b) {
+	return std::max(std::fabs(a[0]-b[0]),
+			std::max(std::fabs(a[1]-b[1]), std::fabs(a[2]-b[2])));
+}
+
+/** Controlled stepper with abs = rel = tol **/
+template<class Stepper> struct ControlledRun {
+	double tol;
+	ControlledRun (double t) : tol(t) {}
+	size_t operator() (const Problem& p, state_type& m) const {
+		size_t n = 0;
+		m = p.m0;
+		integrate_adaptive (make_controlled(tol, tol, Stepper()), counted_bloch(&n),
+				m, p.t0, p.t1, 1.e-8);
+		return n;
+	}
+};
+
+/** Implicit system and Jacobian counting evaluations. A Jacobian costs
+ *  about one RHS evaluation (Bloch matrix and RF) and is counted as such. **/
+struct counted_implicit_system {
+	size_t* n;
+	counted_implicit_system (size_t* c) : n(c) {}
+	inline void operator() (const implicit_state_type& x, implicit_state_type& dxdt,
+			const double t) const {
+		++(*n);
+		bloch_implicit_system<double>() (x, dxdt, t);
+	}
+};
+struct counted_implicit_jacobian {
+	size_t* n;
+	counted_implicit_jacobian (size_t* c) : n(c) {}
+	inline void operator() (const implicit_state_type& x, implicit_matrix_type& J,
+			const double& t, implicit_state_type& dfdt) const {
+		++(*n);
+		bloch_implicit_jacobian<double>() (x, J, t, dfdt);
+	}
+};
+
+/** Controlled rosenbrock4 with abs = rel = tol **/
+struct RosenbrockRun {
+	double tol;
+	RosenbrockRun (double t) : tol(t) {}
+	size_t operator() (const Problem& p, state_type& m) const {
+		size_t n = 0;
+		implicit_state_type x (3);
+		x(0) = p.m0[0]; x(1) = p.m0[1]; x(2) = p.m0[2];
+		integrate_adaptive (make_controlled(tol, tol, rosenbrock4<double>()),
+				std::make_pair(counted_implicit_system(&n), counted_implicit_jacobian(&n)),
+				x, p.t0, p.t1, 1.e-8);
+		m[0] = x(0); m[1] = x(1); m[2] = x(2);
+		return n;
+	}
+};
+
+/** Fixed step stepper, dt dividing the interval **/
+template<class Stepper> struct FixedRun {
+	size_t steps;
+	FixedRun (size_t s) : steps(s) {}
+	size_t operator() (const Problem& p, state_type& m) const {
+		size_t n = 0;
+		m = p.m0;
+		integrate_n_steps (Stepper(), counted_bloch(&n), m, p.t0,
+				(p.t1-p.t0)/steps, steps);
+		return n;
+	}
+};
+
+/** Bloch splitting stepper, dt dividing the interval. The system is not
+ *  evaluated: field evaluations (1 per step, 2 for magnus4) count as RHS
+ *  evaluations. **/
+struct SplittingRun {
+	SplittingScheme scheme;
+	size_t steps;
+	SplittingRun (SplittingScheme s, size_t n) : scheme(s), steps(n) {}
+	size_t operator() (const Problem& p, state_type& m) const {
+		m = p.m0;
+		integrate_n_steps (splitting_stepper<double> (scheme), bloch<double>, m, p.t0,
+				(p.t1-p.t0)/steps, steps);
+		return steps * ((scheme == MAGNUS4_SPLITTING) ? 2 : 1);
+	}
+};
+
+/** Run repeatedly for min_ns, record error, evaluations and time per run **/
+template<class R> static void
+Evaluate (const Problem& p, const std::string& stepper, const double param, const R& run,
+		const double min_ns, std::vector<Result>& results) {
+	Result r;
+	r.problem = p.name;
+	r.stepper = stepper;
+	r.param   = param;
+	r.pareto  = false;
+	state_type m;
+	r.rhs   = run (p, m);
+	r.error = max_error (m, p.ref);
+	size_t calls = 0;
+	Timer timer;
+	do {
+		timer.Start();
+		run (p, m);
+		timer.Stop();
+		escape (m);
+		++calls;
+	} while (timer.Elapsed() < min_ns);
+	r.ns = (double)timer.Elapsed()/calls;
+	results.push_back (r);
+}
+
+/** Sweep all steppers over tolerances / step counts **/
+static void
+Sweep (const Problem& p, const double min_ns, std::vector<Result>& results) {
+	typedef runge_kutta_dopri5<state_type>      dopri5;
+	typedef runge_kutta_cash_karp54<state_type> cash_karp54;
+	typedef runge_kutta_fehlberg78<state_type>  fehlberg78;
+	typedef runge_kutta4<state_type>            rk4;
+	p.Setup();
+	std::cerr << "  " << p.name << std::endl;
+	for (int e = 3; e <= 12; ++e) {
+		double tol = std::pow (10., -e);
+		Evaluate (p, "dopri5", tol, ControlledRun<dopri5>(tol), min_ns, results);
+		Evaluate (p, "cash_karp54", tol, ControlledRun<cash_karp54>(tol), min_ns, results);
+		Evaluate (p, "fehlberg78", tol, ControlledRun<fehlberg78>(tol), min_ns, results);
+		Evaluate (p, "rosenbrock4", tol, RosenbrockRun(tol), min_ns, results);
+	}
+	for (size_t steps = 100; steps <= 100000; steps *= 10) {
+		Evaluate (p, "rk4", (p.t1-p.t0)/steps, FixedRun<rk4>(steps), min_ns, results);
+		Evaluate (p, "rk4", (p.t1-p.t0)/(3*steps), FixedRun<rk4>(3*steps), min_ns, results);
+		Evaluate (p, "splitting", (p.t1-p.t0)/steps,
+				SplittingRun(MIDPOINT_SPLITTING, steps), min_ns, results);
+		Evaluate (p, "magnus4", (p.t1-p.t0)/steps,
+				SplittingRun(MAGNUS4_SPLITTING, steps), min_ns, results);
+	}
+}
+
+/** Observed convergence order of the fixed step schemes: log2 of the error
+ *  ratio per halving of dt, from 64 to 4096 steps. Fails if the splitting
+ *  schemes fall short of their order from 512 to 4096 steps: 2 for midpoint,
+ *  4 for magnus4 without relaxation (2 with, see splitting_stepper). Problems
+ *  they solve to round-off are not checked. **/
+static bool
+ConvergenceOrder (std::ostream& os, const std::vector<Problem>& problems) {
+	typedef runge_kutta4<state_type> rk4;
+	const char* names[3] = { "rk4", "splitting", "magnus4" };
+	bool ok = true;
+	os << "# convergence order (log2 error ratio per halving dt, 64 ... 4096 steps)\n";
+	for (size_t i = 0; i < problems.size(); ++i) {
+		const Problem& p = problems[i];
+		const bool relaxes = (p.t1 - p.t0) > 1.e-6 * std::min (p.spin.t1(), p.spin.t2());
+		p.Setup();
+		for (size_t k = 0; k < 3; ++k) {
+			os << std::left << std::setw(14) << p.name << std::setw(14) << names[k] << std::right;
+			double prev = 0., err512 = 0.;
+			for (size_t steps = 64; steps <= 4096; steps *= 2) {
+				state_type m;
+				const FixedRun<rk4> fixed (steps);
+				const SplittingRun split ((k == 1) ? MIDPOINT_SPLITTING : MAGNUS4_SPLITTING, steps);
+				if (k == 0)
+					fixed (p, m);
+				else
+					split (p, m);
+				const double err = max_error (m, p.ref);
+				if (steps > 64)
+					os << std::fixed << std::setprecision(2) << std::setw(7)
+					   << ((err > 1.e-13 && prev > 1.e-13) ? std::log(prev/err)/std::log(2.) : 0.);
+				prev = err;
+				if (steps == 512)
+					err512 = err;
+			}
+			os << std::scientific << std::setprecision(2) << std::setw(12) << prev << "\n";
+			const double expected = (k == 2 && !relaxes) ? 4. : 2.;
+			const double order = std::log (err512/prev) / std::log (8.);
+			if (k > 0 && err512 > 1.e-10 && !(order >= expected - .1)) {
+				std::cerr << "Convergence order of " << names[k] << " on " << p.name << ": "
+						  << order << ", expected " << expected << std::endl;
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+/** Mark points not dominated in (error, rhs) within their problem.
+ *  Diverged runs (error beyond |m| <= 1) are never optimal. **/
+static void
+MarkPareto (std::vector<Result>& results) {
+	for (size_t i = 0; i < results.size(); ++i) {
+		results[i].pareto = (results[i].error < 1.);
+		if (!results[i].pareto)
+			continue;
+		for (size_t j = 0; j < results.size(); ++j) {
+			if (i == j || results[i].problem != results[j].problem)
+				continue;
+			const Result &a = results[i], &b = results[j];
+			if (b.error <= a.error && b.rhs <= a.rhs && (b.error < a.error || b.rhs < a.rhs)) {
+				results[i].pareto = false;
+				break;
+			}
+		}
+	}
+}
+
+static std::ostream&
+Report (std::ostream& os, const std::vector<Result>& results) {
+	os << std::left << std::setw(14) << "# problem" << std::setw(14) << "stepper"
+	   << std::right << std::setw(12) << "tol/dt" << std::setw(14) << "error"
+	   << std::setw(12) << "rhs_evals" << std::setw(14) << "us/run" << "  pareto\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		os << std::left << std::setw(14) << r.problem << std::setw(14) << r.stepper
+		   << std::right << std::scientific << std::setprecision(2)
+		   << std::setw(12) << r.param << std::setw(14) << r.error
+		   << std::setw(12) << r.rhs << std::setw(14) << 1.e-3*r.ns
+		   << (r.pareto ? "  *" : "") << "\n";
+	}
+	return os;
+}
+
+static void usage (const char* name) {
+	std::cerr << "Usage: " << name << " [-q] [-t seconds] [-p] [-o file]\n"
+			  << "  -q  quick run (short measurement)\n"
+			  << "  -t  minimum measurement time per point (default .05s)\n"
+			  << "  -p  print Pareto optimal points only\n"
+			  << "  -o  output (default stdout)\n";
+}
+
+int main (int argc, char **argv) {
+
+	double min_time = .05;
+	bool pareto_only = false;
+	std::string out;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-q")) {
+			min_time = .005;
+		} else if (!strcmp(argv[i], "-t") && i+1 < argc) {
+			min_time = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-p")) {
+			pareto_only = true;
+		} else if (!strcmp(argv[i], "-o") && i+1 < argc) {
+			out = argv[++i];
+		} else {
+			usage (argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Problem> problems;
+
+	/** Hard pulse: 5 full turns about y in 1ms, relaxation off.
+	 *  m(t) = (-sin(wt), 0, cos(wt)) **/
+	const double tau = 1.e-3, theta = 5.*TWOPI;
+	HardRF<double> hrf (0., tau, std::complex<double>(0., theta/(GAMMA*tau)));
+	Problem hard;
+	hard.name = "hard_pulse";
+	hard.spin = Spin<double> (1., 0., 0., 0., 1.e9, 1.e9, 0.);
+	hard.rf   = &hrf;
+	hard.t0   = 0.;
+	hard.t1   = tau;
+	hard.m0[0] = 0.; hard.m0[1] = 0.; hard.m0[2] = 1.;
+	hard.ref[0] = -std::sin(theta); hard.ref[1] = 0.; hard.ref[2] = std::cos(theta);
+	problems.push_back (hard);
+
+	/** Free precession (50Hz) and relaxation (T1 1s, T2 100ms) over 1s from (1,0,0).
+	 *  mx = e^(-t/T2) cos(wt), my = -e^(-t/T2) sin(wt), mz = 1 - e^(-t/T1) **/
+	const double t1 = 1., t2 = .1, w = TWOPI*50., t = 1.;
+	Problem relax;
+	relax.name = "relaxation";
+	relax.spin = Spin<double> (1., 0., 0., 0., t1, t2, w);
+	relax.rf   = 0;
+	relax.t0   = 0.;
+	relax.t1   = t;
+	relax.m0[0] = 1.; relax.m0[1] = 0.; relax.m0[2] = 0.;
+	relax.ref[0] =  std::exp(-t/t2)*std::cos(w*t);
+	relax.ref[1] = -std::exp(-t/t2)*std::sin(w*t);
+	relax.ref[2] =  1. - std::exp(-t/t1);
+	problems.push_back (relax);
+
+	/** Same with short T2 (50us): stiff **/
+	relax.name = "short_t2";
+	relax.spin = Spin<double> (1., 0., 0., 0., t1, 5.e-5, w);
+	relax.ref[0] =  std::exp(-t/5.e-5)*std::cos(w*t);
+	relax.ref[1] = -std::exp(-t/5.e-5)*std::sin(w*t);
+	problems.push_back (relax);
+
+	/** Adiabatic inversion of the demo (10ms hypsec, T1 1s, T2 60ms).
+	 *  No closed form with relaxation: reference is fehlberg78 at 1e-14 **/
+	AdiabaticRF<double> arf (0., 10.e-3, 200.0e-6);
+	Problem adiabatic;
+	adiabatic.name = "adiabatic";
+	adiabatic.spin = Spin<double> (1., 0., 0., 0., 1., 60.e-3, 0.);
+	adiabatic.rf   = &arf;
+	adiabatic.t0   = 0.;
+	adiabatic.t1   = arf.Duration();
+	adiabatic.m0[0] = 0.; adiabatic.m0[1] = 0.; adiabatic.m0[2] = 1.;
+	adiabatic.Setup();
+	ControlledRun<runge_kutta_fehlberg78<state_type> > (1.e-14) (adiabatic, adiabatic.ref);
+	problems.push_back (adiabatic);
+
+	/** Same without relaxation: rotation only **/
+	adiabatic.name = "adiabatic_rot";
+	adiabatic.spin = Spin<double> (1., 0., 0., 0., 1.e9, 1.e9, 0.);
+	adiabatic.Setup();
+	ControlledRun<runge_kutta_fehlberg78<state_type> > (1.e-14) (adiabatic, adiabatic.ref);
+	problems.push_back (adiabatic);
+
+	std::cerr << "Sweeping steppers" << std::endl;
+	std::vector<Result> results;
+	for (size_t i = 0; i < problems.size(); ++i)
+		Sweep (problems[i], 1.e9*min_time, results);
+	MarkPareto (results);
+
+	if (pareto_only) {
+		std::vector<Result> pareto;
+		for (size_t i = 0; i < results.size(); ++i)
+			if (results[i].pareto)
+				pareto.push_back (results[i]);
+		results.swap (pareto);
+	}
+
+	bool orders;
+	if (out.empty()) {
+		Report (std::cout, results);
+		orders = ConvergenceOrder (std::cout, problems);
+	} else {
+		std::ofstream ofs (out.c_str());
+		Report (ofs, results);
+		orders = ConvergenceOrder (ofs, problems);
+	}
+
+	return orders ? 0 : 1;
+
+}